@@ -123,6 +123,69 @@ def extract_data():
 
 tribes = {0:"None", 14:"Murloc", 15:"Demon", 17:"Mech", 20:"Beast", 24:"Dragon", 26:"All"}
 
+# Events that minions have handlers for, each of these needs a handler in minion_events.cpp
+# Deathrattles in the card data without an entry here do nothing
+hook_names = ["FRIENDLY_SUMMON", "FRIENDLY_DEATH", "AFTER_FRIENDLY_ATTACK", "BREAK_FRIENDLY_DIVINE_SHIELD",
+              "DEATHRATTLE", "DAMAGED", "ATTACK_AND_KILL", "AURA"]
+event_hooks = {
+  "MurlocTidecaller": ["FRIENDLY_SUMMON"],
+  "WrathWeaver":      ["FRIENDLY_SUMMON"],
+  "CobaltGuardian":   ["FRIENDLY_SUMMON"],
+  "CrowdFavorite":    ["FRIENDLY_SUMMON"],
+  "PackLeader":       ["FRIENDLY_SUMMON"],
+  "MamaBear":         ["FRIENDLY_SUMMON"],
+  "PreNerfMamaBear":  ["FRIENDLY_SUMMON"],
+  "ScavengingHyena":  ["FRIENDLY_DEATH"],
+  "SoulJuggler":      ["FRIENDLY_DEATH"],
+  "Junkbot":          ["FRIENDLY_DEATH"],
+  "FesterootHulk":    ["AFTER_FRIENDLY_ATTACK"],
+  "BolvarFireblood":  ["BREAK_FRIENDLY_DIVINE_SHIELD"],
+  "Mecharoo":         ["DEATHRATTLE"],
+  "SelflessHero":     ["DEATHRATTLE"],
+  "FiendishServant":  ["DEATHRATTLE"],
+  "HarvestGolem":     ["DEATHRATTLE"],
+  "KaboomBot":        ["DEATHRATTLE"],
+  "KindlyGrandmother": ["DEATHRATTLE"],
+  "MountedRaptor":    ["DEATHRATTLE"],
+  "RatPack":          ["DEATHRATTLE"],
+  "SpawnOfNZoth":     ["DEATHRATTLE"],
+  "Imprisoner":       ["DEATHRATTLE"],
+  "InfestedWolf":     ["DEATHRATTLE"],
+  "PilotedShredder":  ["DEATHRATTLE"],
+  "ReplicatingMenace": ["DEATHRATTLE"],
+  "TortollanShellraiser": ["DEATHRATTLE"],
+  "PilotedSkyGolem":  ["DEATHRATTLE"],
+  "TheBeast":         ["DEATHRATTLE"],
+  "GoldrinnTheGreatWolf": ["DEATHRATTLE"],
+  "KingBagurgle":     ["DEATHRATTLE"],
+  "MechanoEgg":       ["DEATHRATTLE"],
+  "SatedThreshadon":  ["DEATHRATTLE"],
+  "SavannahHighmane": ["DEATHRATTLE"],
+  "Ghastcoiler":      ["DEATHRATTLE"],
+  "KangorsApprentice": ["DEATHRATTLE"],
+  "SneedsOldShredder": ["DEATHRATTLE"],
+  "Voidlord":         ["DEATHRATTLE"],
+  "ImpGangBoss":      ["DAMAGED"],
+  "SecurityRover":    ["DAMAGED"],
+  "IronhideDirehorn": ["ATTACK_AND_KILL"],
+  "TheBoogeymonster": ["ATTACK_AND_KILL"],
+  "DireWolfAlpha":    ["AURA"],
+  "MurlocWarleader":  ["AURA"],
+  "OldMurkEye":       ["AURA"],
+  "PhalanxCommander": ["AURA"],
+  "Siegebreaker":     ["AURA"],
+  "MalGanis":         ["AURA"],
+}
+
+def hooks_of(e):
+  return event_hooks.get(e.enum, [])
+
+def hooks_expr(e):
+  hooks = hooks_of(e)
+  if not hooks:
+    return "0"
+  return "|".join("HOOK_" + h for h in hooks)
+
 class CustomEntity:
   id = None
   tribe = "None"
@@ -231,11 +294,22 @@ def write_enums_hpp(minions, heroes):
     f.write("// -----------------------------------------------------------------------------\n")
     f.write("// Heroes and hero powers\n")
     f.write("// -----------------------------------------------------------------------------\n\n")
-    f.write("enum class HeroType {\n")
+    f.write("enum class HeroType : unsigned char {\n")
     for e in heroes:
       f.write("  {},\n".format(e.enum))
     f.write("};\n\n")
-    f.write("const int HeroType_count = {};\n".format(len(heroes)))
+    f.write("const int HeroType_count = {};\n\n".format(len(heroes)))
+
+    f.write("// -----------------------------------------------------------------------------\n")
+    f.write("// Minion event handlers\n")
+    f.write("// -----------------------------------------------------------------------------\n\n")
+    f.write("// Minion types with a handler for each event, used to build the dispatch tables in minion_events.cpp\n")
+    for hook in hook_names:
+      f.write("#define FOR_EACH_{}_MINION(X)".format(hook))
+      for m in minions:
+        if hook in hooks_of(m[0]):
+          f.write(" \\\n  X({})".format(m[0].enum))
+      f.write("\n")
 
 # ------------------------------------------------------------------------------
 # enum_data.cpp
@@ -277,14 +351,15 @@ def write_enum_data_cpp(minions, heroes):
     f.write("const MinionInfo minion_info[] = {\n")
     for m in minions:
       e = m[0]
-      f.write("  {{{}, {{{},{}}}, {}, Tribe::{}, {},{}, {},{},{},{},{}, {},{}}},\n".format(
+      f.write("  {{{}, {{{},{}}}, {}, Tribe::{}, {},{}, {},{},{},{},{}, {},{}, {}}},\n".format(
         cstr(e.name), cstr(e.id), cstr(m[1].id if m[1] is not None else None),
         e.tier, e.tribe,
         e.get_int("ATK"), e.get_int("HEALTH"),
         cbool(e.get_bool("TAUNT")), cbool(e.get_bool("DIVINE_SHIELD")), cbool(e.get_bool("POISONOUS")), cbool(e.get_bool("WINDFURY")),
         cbool(e.cleave),
         cbool(e.get_bool("BATTLECRY")),
-        cbool(e.get_bool("IS_BACON_POOL_MINION"))
+        cbool(e.get_bool("IS_BACON_POOL_MINION")),
+        hooks_expr(e)
       ))
     f.write("};\n\n")
 
@@ -313,9 +388,13 @@ def write_minion_list(f, minions, name, filter):
     if filter(e):
       f.write("  MinionType::{},\n".format(e.enum))
   f.write("}};\n".format(name))
-  f.write("MinionType random_{}_minion(BattleRNG& rng, int player) {{\n".format(name))
+  f.write("template <typename R>\n")
+  f.write("MinionType random_{}_minion(R& rng, int player) {{\n".format(name))
   f.write("  return random_element({}_minions, rng, rng_key(RNGType::{}Minion, player));\n".format(name,enum_name(name)))
-  f.write("}\n\n")
+  f.write("}\n")
+  f.write("#define INSTANTIATE(R) template MinionType random_{}_minion(R& rng, int player);\n".format(name))
+  f.write("FOR_EACH_RNG(INSTANTIATE)\n")
+  f.write("#undef INSTANTIATE\n\n")
 
 # ------------------------------------------------------------------------------
 # Main
@@ -5,7 +5,8 @@ using std::endl;
 // Course of battle, attacking
 // -----------------------------------------------------------------------------
 
-void Battle::run() {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::run() {
   start();
   int round = 0;
   bool missed_prev = 0;
@@ -26,7 +27,8 @@ void Battle::run() {
   }
 }
 
-void Battle::start() {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::start(int first_player) {
   if (turn >= 0) return;
   // player with most minions attacks first
   int n0 = board[0].minions.size(), n1 = board[1].minions.size();
@@ -34,6 +36,8 @@ void Battle::start() {
     turn = 0;
   } else if (n0 < n1) {
     turn = 1;
+  } else if (first_player >= 0) {
+    turn = first_player;
   } else {
     turn = rng.random(2, rng_key(RNGType::FirstPlayer));
   }
@@ -55,7 +59,8 @@ int find_attacker(Board const& board) {
   return -1;
 }
 
-bool Battle::attack_round() {
+template <typename Trace, typename R>
+bool BasicBattle<Trace,R>::attack_round() {
   // find attacker
   Board& active = board[turn];
   int from = find_attacker(active);
@@ -78,7 +83,8 @@ bool Battle::attack_round() {
   return true;
 }
 
-void Battle::single_attack_by(int player, int from) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::single_attack_by(int player, int from) {
   Minion& attacker = board[player].minions[from];
   bool cleave = attacker.cleave();
   // find a target
@@ -87,9 +93,7 @@ void Battle::single_attack_by(int player, int from) {
   int target = attacker.type == MinionType::ZappSlywick
                  ? enemy.lowest_attack_target(rng, rng_key(RNGType::Attack,player,attacker))
                  : enemy.random_attack_target(rng, rng_key(RNGType::Attack,player,attacker));
-  if (verbose && log) {
-    *log << "attack by " << player << "." << from << ", " << attacker << (cleave ? "[C]" : "") << " to " << target << endl;
-  }
+  trace.attack(player, from, attacker, cleave, target);
   // Make a snapshot of the defending minion, so we know attack values
   Minion defender_snapshot = enemy.minions[target];
   // minions might move during all of this because of damage triggers
@@ -123,7 +127,9 @@ void Battle::single_attack_by(int player, int from) {
   check_for_deaths();
 }
 
-void Battle::on_after_friendly_attack(Minion const& attacker, int player) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::on_after_friendly_attack(Minion const& attacker, int player) {
+  if (!board[player].has_listeners(HOOK_AFTER_FRIENDLY_ATTACK)) return;
   board[player].minions.for_each_alive([&](Minion& m) {
     m.on_after_friendly_attack(attacker);
   });
@@ -133,48 +139,54 @@ void Battle::on_after_friendly_attack(Minion const& attacker, int player) {
 // Damage
 // -----------------------------------------------------------------------------
 
-bool Battle::damage(int player, int pos, int amount, bool poison) {
+template <typename Trace, typename R>
+bool BasicBattle<Trace,R>::damage(int player, int pos, int amount, bool poison) {
   if (amount <= 0) return false;
   Minion& m = board[player].minions[pos];
-  if (verbose >= 2 && log) {
-    *log << "damage of " << amount << (poison ? "[P]" : "") << " to " << player << "." << pos << ", " << m << endl;
-  }
+  trace.damage(player, pos, amount, poison, m);
   if (m.divine_shield) {
     m.divine_shield = false;
     on_break_divine_shield(player);
     return false;
   } else {
-    m.health -= amount;
+    m.health = clamp_stat(m.health - amount);
     if (m.health > 0 && poison) {
       m.health = 0;
     }
+    if (m.dead()) {
+      board[player].mark_dying(pos);
+      if (Board::is_multiplier_minion(m.type)) board[player].invalidate_multipliers();
+    }
     m.on_damaged(*this, player, pos);
     // if (m.health <= 0) destroy_minion(player, pos);
     return true;
   }
 }
 
-bool Battle::damage(Minion const& attacker, int player, int pos) {
-  if (verbose >= 4 && log) {
-    *log << "damage by " << attacker << " to " << player << "." << pos << endl;
-  }
+template <typename Trace, typename R>
+bool BasicBattle<Trace,R>::damage(Minion const& attacker, int player, int pos) {
+  trace.damage_by(attacker, player, pos);
   return damage(player, pos, attacker.attack, attacker.poison);
 }
 
-void Battle::damage_random_minion(int player, int amount) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::damage_random_minion(int player, int amount) {
   int i = board[player].random_living_minion(rng, rng_key(RNGType::Damage,player,amount));
   if (i != -1) {
     damage(player, i, amount);
   }
 }
 
-void Battle::damage_all(int player, int amount) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::damage_all(int player, int amount) {
   board[player].minions.for_each_with_pos([&](int pos, Minion& m) {
     if (!m.dead()) damage(player, pos, amount);
   });
 }
 
-void Battle::on_break_divine_shield(int player) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::on_break_divine_shield(int player) {
+  if (!board[player].has_listeners(HOOK_BREAK_FRIENDLY_DIVINE_SHIELD)) return;
   board[player].minions.for_each_alive([&](Minion& m) {
     m.on_break_friendly_divine_shield();
   });
@@ -184,7 +196,8 @@ void Battle::on_break_divine_shield(int player) {
 // Dying minions
 // -----------------------------------------------------------------------------
 
-void Battle::check_for_deaths() {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::check_for_deaths() {
   // Two step algorithm
   //  first: find dead minions, put them in a list and remove from board
   //  then: run their deathrattles and other triggers
@@ -196,12 +209,19 @@ void Battle::check_for_deaths() {
       // filter to keep only alive minions
       Board& board = this->board[player];
       num_dead[player] = 0;
-      int next = 0; // positions in cleaned up board
-      for (int i=0; board.minions.contains(i); ++i) {
+      // common case: nothing died on this board
+      if (!board.any_dying()) continue;
+      // minions before the first dying one stay where they are
+      int first = board.first_dying();
+      int next = first; // positions in cleaned up board
+      for (int i=first; board.minions.contains(i); ++i) {
         if (board.next_attacker == i) {
           board.next_attacker = next;
         }
         if (board.minions[i].dead()) {
+          if (Board::is_multiplier_minion(board.minions[i].type)) board.invalidate_multipliers();
+          // Note: minions [0,next) are already moved to their final position
+          board.aura_removed(board.minions[i], next-1, i+1);
           positions[player][num_dead[player]] = next;
           dead_minions[player][num_dead[player]] = board.minions[i];
           // update tracked positions: this minion is dead
@@ -221,6 +241,8 @@ void Battle::check_for_deaths() {
         }
       }
       board.minions.remove_all_from(next);
+      board.clear_dying();
+      if (num_dead[player]) board.recompute_listeners();
     }
     if (num_dead[0] == 0 && num_dead[1] == 0) return;
     // run death triggers
@@ -237,10 +259,9 @@ void Battle::check_for_deaths() {
   }
 }
 
-void Battle::on_death(Minion const& dead_minion, int player, int pos) {
-  if (verbose && log) {
-    *log << "death: " << dead_minion << " at " << player << "." << pos << endl;
-  }
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::on_death(Minion const& dead_minion, int player, int pos) {
+  trace.death(dead_minion, player, pos);
   // deathrattle
   int deathrattle_count = board[player].extra_deathrattle_count();
   for (int i=0; i<deathrattle_count; ++i) {
@@ -251,9 +272,11 @@ void Battle::on_death(Minion const& dead_minion, int player, int pos) {
     summon(dead_minion.reborn_copy(), player, pos);
   }
   // triggers
-  board[player].minions.for_each_alive([&,player](Minion& m) {
-    m.on_friendly_death(*this, dead_minion, player);
-  });
+  if (board[player].has_listeners(HOOK_FRIENDLY_DEATH)) {
+    board[player].minions.for_each_alive([&,player](Minion& m) {
+      m.on_friendly_death(*this, dead_minion, player);
+    });
+  }
   // track mechs that died
   if (dead_minion.has_tribe(Tribe::Mech)) {
     if (!mechs_that_died[player].full()) {
@@ -266,11 +289,13 @@ void Battle::on_death(Minion const& dead_minion, int player, int pos) {
 // Summoning
 // -----------------------------------------------------------------------------
 
-void Battle::summon(Minion const& m, int player, int pos) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::summon(Minion const& m, int player, int pos) {
   summon_many(1, m, player, pos);
 }
 
-void Battle::summon_many(int count, Minion const& m, int player, int pos) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::summon_many(int count, Minion const& m, int player, int pos) {
   if (count == 0) return;
   count *= board[player].extra_summon_count();
   for (int i=0; i<count && !board[player].minions.full(); ++i) {
@@ -280,7 +305,8 @@ void Battle::summon_many(int count, Minion const& m, int player, int pos) {
   recompute_auras();
 }
 
-void Battle::summon_for_opponent(Minion const& m, int player) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::summon_for_opponent(Minion const& m, int player) {
   int count = board[player].extra_summon_count();
   for (int i=0; i<count && !board[1-player].minions.full(); ++i) {
     int pos = board[1-player].append(m);
@@ -289,11 +315,13 @@ void Battle::summon_for_opponent(Minion const& m, int player) {
   recompute_auras();
 }
 
-void Battle::on_summoned(Minion& summoned, int player, int pos, bool played) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::on_summoned(Minion& summoned, int player, int pos, bool played) {
   board[player].on_summoned(summoned, pos, played);
 }
 
 void Board::on_summoned(Minion& summoned, int pos, bool played) {
+  if (!has_listeners(HOOK_FRIENDLY_SUMMON)) return;
   minions.for_each_with_pos([&](int p, Minion& m) {
     if (p != pos) m.on_friendly_summon(*this, summoned, played);
   });
@@ -303,12 +331,11 @@ void Board::on_summoned(Minion& summoned, int pos, bool played) {
 // Hero powers
 // -----------------------------------------------------------------------------
 
-void Battle::do_hero_powers() {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::do_hero_powers() {
   for (int player=0; player<2; ++player) {
     if (board[player].use_hero_power) {
-      if (verbose >= 2 && log) {
-        *log << "Hero power " << board[player].hero << " for " << player << endl;
-      }
+      trace.hero_power(board[player].hero, player);
       do_hero_power(board[player].hero, player);
       board[player].use_hero_power = false;
     }
@@ -321,18 +348,47 @@ void Battle::do_hero_powers() {
 
 // As an optimization, we track if there are any minions with auras on the board
 // if there are none, we can skip this step.
+// During battle, auras are updated incrementally (see Board::update_auras).
 
-void Battle::recompute_auras() {
+// Check incremental aura updates against a full recompute
+#ifndef CHECK_AURAS
+#define CHECK_AURAS 0
+#endif
+
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::recompute_auras() {
   for (int player=0; player<2; ++player) {
     recompute_auras(player);
   }
 }
 
-void Battle::recompute_auras(int player) {
-  board[player].recompute_auras(&board[1-player]);
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::recompute_auras(int player) {
+  board[player].update_auras(&board[1-player]);
+  #if CHECK_AURAS
+    Board check = board[player];
+    check.recompute_auras(&board[1-player]);
+    for (int i=0; board[player].minions.contains(i); ++i) {
+      Minion const& a = board[player].minions[i];
+      Minion const& b = check.minions[i];
+      if (a.attack != b.attack || a.health != b.health || a.attack_aura != b.attack_aura || a.health_aura != b.health_aura) {
+        std::cerr << "Incremental aura mismatch for " << player << "." << i << ": " << a << " instead of " << b << endl;
+        std::cerr << *this;
+        std::abort();
+      }
+    }
+  #endif
 }
 
 void Board::recompute_auras(Board const* enemy_board) {
+  // reset incremental aura state
+  aura_totals = AuraTotals();
+  minions.for_each([this](Minion& m) {
+    aura_totals.add(m, 1);
+    m.aura_dirty = false;
+  });
+  aura_all_dirty = aura_any_dirty = aura_full_recompute = false;
+  aura_enemy_murlocs = enemy_board ? enemy_board->minions.count_if([](Minion const& m) { return m.has_tribe(Tribe::Murloc); }) : 0;
   if (!any_auras) return;
   // clear auras
   minions.for_each([&](Minion& m) {
@@ -350,9 +406,101 @@ void Board::recompute_auras(Board const* enemy_board) {
     if (m.invalid_aura) {
       m.invalid_aura = false;
       // stats didn't include aura, now that we have recomputed aura effects, we can compensate
-      m.attack -= m.attack_aura;
-      m.health -= m.health_aura;
+      m.attack = clamp_stat(m.attack - m.attack_aura);
+      m.health = clamp_stat(m.health - m.health_aura);
+    }
+  });
+  mark_dead_minions();
+}
+
+void Board::update_auras(Board const* enemy_board) {
+  if (aura_full_recompute) {
+    recompute_auras(enemy_board);
+    return;
+  }
+  // Old Murk-Eye depends on the number of enemy murlocs
+  int enemy_murlocs = enemy_board ? enemy_board->num_murlocs() : 0;
+  if (enemy_murlocs != aura_enemy_murlocs) {
+    aura_enemy_murlocs = enemy_murlocs;
+    if (aura_totals.murk_eyes) aura_all_dirty = true;
+  }
+  if (!aura_all_dirty && !aura_any_dirty) return;
+  minions.for_each_with_pos([this,enemy_murlocs](int pos, Minion& m) {
+    if (aura_all_dirty || m.aura_dirty) {
+      int attack, health;
+      aura_target(pos, enemy_murlocs, attack, health);
+      m.set_aura_buff(attack, health);
+      m.aura_dirty = false;
+      // losing an aura can kill a minion
+      if (m.dead()) mark_dying(pos);
     }
   });
+  aura_all_dirty = aura_any_dirty = false;
 }
 
+void Board::aura_target(int pos, int enemy_murlocs, int& attack, int& health) const {
+  Minion const& m = minions[pos];
+  // auras don't apply to the minion itself
+  AuraTotals self;
+  self.add(m, 1);
+  attack = health = 0;
+  if (m.has_tribe(Tribe::Murloc)) {
+    attack += aura_totals.warleader - self.warleader;
+  }
+  if (m.taunt) {
+    attack += aura_totals.phalanx - self.phalanx;
+  }
+  if (m.has_tribe(Tribe::Demon)) {
+    attack += aura_totals.siegebreaker - self.siegebreaker;
+    attack += aura_totals.malganis - self.malganis;
+    health += aura_totals.malganis - self.malganis;
+  }
+  if (aura_totals.dire_wolves) {
+    for (int adjacent : {pos-1, pos+1}) {
+      if (minions.contains(adjacent) && minions[adjacent].type == MinionType::DireWolfAlpha) {
+        attack += minions[adjacent].double_if_golden(1);
+      }
+    }
+  }
+  if (m.type == MinionType::OldMurkEye) {
+    attack += m.double_if_golden(aura_totals.murlocs - 1 + enemy_murlocs);
+  }
+}
+
+void Board::aura_inserted(int pos) {
+  Minion const& m = minions[pos];
+  if (m.invalid_aura) {
+    // can't be done incrementally
+    aura_full_recompute = true;
+    return;
+  }
+  if (aura_totals.add(m, 1)) aura_all_dirty = true;
+  if (m.has_tribe(Tribe::Murloc) && aura_totals.murk_eyes) aura_all_dirty = true;
+  if (aura_totals.dire_wolves) {
+    // adjacency changed
+    mark_aura_dirty(pos-1);
+    mark_aura_dirty(pos+1);
+  }
+  if (aura_totals.any() || m.attack_aura || m.health_aura) {
+    mark_aura_dirty(pos);
+  }
+}
+
+void Board::aura_removed(Minion const& m, int left, int right) {
+  if (aura_totals.add(m, -1)) aura_all_dirty = true;
+  if (m.has_tribe(Tribe::Murloc) && aura_totals.murk_eyes) aura_all_dirty = true;
+  if (m.type == MinionType::DireWolfAlpha || aura_totals.dire_wolves) {
+    // left and right become adjacent
+    mark_aura_dirty(left);
+    mark_aura_dirty(right);
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// Instantiations
+// -----------------------------------------------------------------------------
+
+#define INSTANTIATE_BATTLE(Trace, R) template struct BasicBattle<Trace,R>;
+#define INSTANTIATE_BATTLES(R) FOR_EACH_TRACE(INSTANTIATE_BATTLE, R)
+FOR_EACH_RNG(INSTANTIATE_BATTLES)
@@ -3,33 +3,153 @@
 #include "board.hpp"
 #include <iostream>
 #include <cstdlib>
+#include <vector>
 using std::ostream;
 using std::endl;
 
+// -----------------------------------------------------------------------------
+// Tracing
+// -----------------------------------------------------------------------------
+
+// A battle reports what happens through its trace policy.
+// The policy is a template parameter, so simulations with SilentTrace don't pay for logging at all.
+
+// No logging, used for simulations
+struct SilentTrace {
+  void attack(int player, int from, Minion const& attacker, bool cleave, int target) {}
+  void damage(int player, int pos, int amount, bool poison, Minion const& target) {}
+  void damage_by(Minion const& attacker, int player, int pos) {}
+  void death(Minion const& dead_minion, int player, int pos) {}
+  void hero_power(HeroType hero, int player) {}
+};
+
+// Log to a stream, with more messages for higher verbosity levels
+struct TextTrace {
+  ostream* log = nullptr;
+  int verbose = 0;
+
+  TextTrace() {}
+  TextTrace(ostream* log, int verbose) : log(log), verbose(verbose) {}
+
+  void attack(int player, int from, Minion const& attacker, bool cleave, int target) {
+    if (verbose >= 1 && log) {
+      *log << "attack by " << player << "." << from << ", " << attacker << (cleave ? "[C]" : "") << " to " << target << endl;
+    }
+  }
+  void damage(int player, int pos, int amount, bool poison, Minion const& target) {
+    if (verbose >= 2 && log) {
+      *log << "damage of " << amount << (poison ? "[P]" : "") << " to " << player << "." << pos << ", " << target << endl;
+    }
+  }
+  void damage_by(Minion const& attacker, int player, int pos) {
+    if (verbose >= 4 && log) {
+      *log << "damage by " << attacker << " to " << player << "." << pos << endl;
+    }
+  }
+  void death(Minion const& dead_minion, int player, int pos) {
+    if (verbose >= 1 && log) {
+      *log << "death: " << dead_minion << " at " << player << "." << pos << endl;
+    }
+  }
+  void hero_power(HeroType hero, int player) {
+    if (verbose >= 2 && log) {
+      *log << "Hero power " << hero << " for " << player << endl;
+    }
+  }
+};
+
+// Record events as data, for tools that analyze battles (see the REPL events command)
+enum class TraceEventType : unsigned char {
+  Attack, Damage, Death, HeroPower
+};
+
+struct TraceEvent {
+  TraceEventType type;
+  int player, pos;
+  int amount;   // attack target for Attack, damage for Damage
+  Minion minion; // attacker, damaged minion, or dead minion
+};
+
+struct EventTrace {
+  std::vector<TraceEvent> events;
+
+  void attack(int player, int from, Minion const& attacker, bool cleave, int target) {
+    events.push_back({TraceEventType::Attack, player, from, target, attacker});
+  }
+  void damage(int player, int pos, int amount, bool poison, Minion const& target) {
+    events.push_back({TraceEventType::Damage, player, pos, amount, target});
+  }
+  void damage_by(Minion const& attacker, int player, int pos) {}
+  void death(Minion const& dead_minion, int player, int pos) {
+    events.push_back({TraceEventType::Death, player, pos, 0, dead_minion});
+  }
+  void hero_power(HeroType hero, int player) {
+    events.push_back({TraceEventType::HeroPower, player, -1, static_cast<int>(hero), Minion()});
+  }
+};
+
+// one event per line: type, player.pos, amount and minion
+inline ostream& operator << (ostream& s, TraceEvent const& e) {
+  switch (e.type) {
+    case TraceEventType::Attack:
+      return s << "attack " << e.player << "." << e.pos << " to " << e.amount << ", " << e.minion;
+    case TraceEventType::Damage:
+      return s << "damage " << e.player << "." << e.pos << " of " << e.amount << ", " << e.minion;
+    case TraceEventType::Death:
+      return s << "death " << e.player << "." << e.pos << ", " << e.minion;
+    case TraceEventType::HeroPower:
+      return s << "hero power " << e.player << ", " << static_cast<HeroType>(e.amount);
+  }
+  return s;
+}
+
+// The battle code is explicitly instantiated for these trace policies, with each rng type in FOR_EACH_RNG
+#define FOR_EACH_TRACE(X, R) X(SilentTrace, R) X(TextTrace, R) X(EventTrace, R)
+
 // -----------------------------------------------------------------------------
 // Battle state
 // -----------------------------------------------------------------------------
 
 const int MAX_MECHS_THAT_DIED = 4;
 
-struct Battle {
+// position of the minion that attacks next, or -1 if no minion can attack
+int find_attacker(Board const& board);
+
+template <typename Trace, typename R>
+struct BasicBattle {
   int turn = -1; // player to attack next
   Board board[2];
   // randomness
-  BattleRNG& rng;
+  R& rng;
   // mechs that died for each player
   MinionArray<MAX_MECHS_THAT_DIED> mechs_that_died[2];
   // logging
-  int verbose = 0;
-  ostream* log;
+  Trace trace;
 
-  Battle(Board const& b0, Board const& b1, ostream* log = nullptr, BattleRNG& rng = global_battle_rng)
+  BasicBattle(Board const& b0, Board const& b1, Trace const& trace = Trace(), R& rng = global_rng_for<R>())
     : board{b0,b1}
     , rng(rng)
-    , log(log)
+    , trace(trace)
   {
-    recompute_auras();
+    // minions might have been modified directly
+    for (int player=0; player<2; ++player) {
+      board[player].recompute_listeners();
+      board[player].invalidate_multipliers();
+    }
+    for (int player=0; player<2; ++player) {
+      board[player].recompute_auras(&board[1-player]);
+      board[player].mark_dead_minions();
+    }
   }
+  // start a new battle from a prepared one (with auras already computed), using a different rng
+  template <typename PreparedRNG>
+  BasicBattle(BasicBattle<Trace,PreparedRNG> const& prepared, R& rng)
+    : turn(prepared.turn)
+    , board{prepared.board[0],prepared.board[1]}
+    , rng(rng)
+    , mechs_that_died{prepared.mechs_that_died[0],prepared.mechs_that_died[1]}
+    , trace(prepared.trace)
+  {}
 
   bool started() const {
     return turn >= 0;
@@ -49,7 +169,8 @@ struct Battle {
   // Simulate a battle
   void run();
   // pre start: decide who goes first, run hero powers
-  void start();
+  // first_player is the player that attacks first if both boards have the same number of minions, or -1 to pick at random
+  void start(int first_player = -1);
 
   // Attacking
   bool attack_round(); // return true if an attack happened
@@ -87,7 +208,16 @@ struct Battle {
   void recompute_auras();
 };
 
-inline ostream& operator << (ostream& s, Battle const& b) {
+// Battles used for simulation, with the default rng
+// A prepared Battle can be run with any rng policy, see simulate_chunk
+using Battle = BasicBattle<SilentTrace, BattleRNG>;
+// Battles that log to a stream, used for stepping through battles in the REPL
+using VerboseBattle = BasicBattle<TextTrace, BattleRNG>;
+
+static_assert(sizeof(Battle) <= 5*64, "Battle should fit in five cache lines");
+
+template <typename Trace, typename R>
+inline ostream& operator << (ostream& s, BasicBattle<Trace,R> const& b) {
   s << b.board[0];
   s << "VS" << endl;
   s << b.board[1];
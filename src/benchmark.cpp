@@ -12,19 +12,23 @@ void tournament_benchmark(Boards const& boards) {
   using namespace std::chrono;
   int n = (int)boards.size();
   int runs = 5000;
-  vector<double> wr;
+  vector<double> wr(n);
   auto start = high_resolution_clock::now();
+  // all matchups in one batch
+  vector<Matchup> matchups;
+  for (int k=0; k<n*n; ++k) {
+    matchups.push_back({boards[k/n].board, boards[k%n].board});
+  }
+  vector<ScoreSummary> stats = simulate_batch(matchups, runs);
   for (int i=0; i<n; ++i) {
-    double w = 0;
     for (int j=0; j<n; ++j) {
-      auto stats = simulate(boards[i].board, boards[j].board, runs);
-      w += stats.win_rate(0);
+      wr[i] += stats[i*n+j].win_rate(0);
     }
-    wr.push_back(w);
   }
   auto end = high_resolution_clock::now();
   duration<double> t = end-start;
   cout << "Time: " << setprecision(5) << t.count();
+  cout << "    battles/sec: " << setprecision(4) << (n * n * runs / t.count()) << setprecision(5);
   cout << "    (";
   for (auto w : wr) {
     cout << " " << (w/n);
@@ -32,14 +36,125 @@ void tournament_benchmark(Boards const& boards) {
   cout << ")" << endl;
 }
 
+// -----------------------------------------------------------------------------
+// Cost of a single attack
+// -----------------------------------------------------------------------------
+
+// Run battles on a single thread, and measure the time per attack (including deaths and triggers)
+void attack_benchmark(Boards const& boards) {
+  using namespace std::chrono;
+  int n = (int)boards.size();
+  int runs = 2000;
+  vector<Battle> prepared;
+  for (int k=0; k<n*n; ++k) {
+    prepared.emplace_back(boards[k/n].board, boards[k%n].board);
+  }
+  int64_t attacks = 0;
+  int checksum = 0;
+  auto start = high_resolution_clock::now();
+  for (int k=0; k<n*n; ++k) {
+    RNG stream = RNG::stream(0, k);
+    BattleRNG rng(stream);
+    for (int i=0; i<runs; ++i) {
+      rng.start();
+      Battle battle(prepared[k], rng);
+      battle.start();
+      bool missed_prev = false;
+      while (!battle.done()) {
+        bool ok = battle.attack_round();
+        if (ok) attacks++;
+        else if (missed_prev) break;
+        missed_prev = !ok;
+      }
+      checksum += battle.score();
+    }
+  }
+  auto end = high_resolution_clock::now();
+  duration<double> t = end-start;
+  cout << "Attacks: " << attacks << "    ns/attack: " << setprecision(4) << (t.count() * 1e9 / attacks);
+  cout << "    ns/battle: " << (t.count() * 1e9 / (n * n * runs)) << setprecision(5);
+  cout << "    (checksum " << checksum << ")" << endl;
+}
+
+// -----------------------------------------------------------------------------
+// Cost of copying the battle state
+// -----------------------------------------------------------------------------
+
+// Every simulated battle starts by copying a prepared battle
+void copy_benchmark(Boards const& boards) {
+  using namespace std::chrono;
+  int n = (int)boards.size();
+  vector<Battle> prepared;
+  for (int k=0; k<n*n; ++k) {
+    prepared.emplace_back(boards[k/n].board, boards[k%n].board);
+  }
+  RNG stream = RNG::stream(0, 0);
+  BattleRNG rng(stream);
+  const int batch = 1000, reps = 2000;
+  vector<Battle> copies;
+  copies.reserve(batch);
+  int checksum = 0;
+  auto start = high_resolution_clock::now();
+  for (int rep=0; rep<reps; ++rep) {
+    copies.clear();
+    for (int i=0; i<batch; ++i) {
+      copies.emplace_back(prepared[(rep + i) % (n*n)], rng);
+    }
+    checksum += copies[rep % batch].board[1].minions.size();
+  }
+  auto end = high_resolution_clock::now();
+  duration<double> t = end-start;
+  cout << "sizeof Minion: " << sizeof(Minion) << ", Board: " << sizeof(Board) << ", Battle: " << sizeof(Battle);
+  cout << "    ns/copy: " << setprecision(4) << (t.count() * 1e9 / (batch * reps)) << setprecision(5);
+  cout << "    (checksum " << checksum << ")" << endl;
+}
+
+// -----------------------------------------------------------------------------
+// Cost of keyed random numbers
+// -----------------------------------------------------------------------------
+
+// Calls to the battle rng with a mix of keys similar to battles:
+// a few keys are used many times in each run, many keys are used only once or twice
+void keyed_rng_benchmark() {
+  using namespace std::chrono;
+  const int runs = 200000, calls = 40;
+  RNG stream = RNG::stream(0, 0);
+  BattleRNG rng(stream);
+  int64_t checksum = 0;
+  auto start = high_resolution_clock::now();
+  for (int i=0; i<runs; ++i) {
+    rng.start();
+    for (int j=0; j<calls; ++j) {
+      int player = j & 1;
+      int n = 2 + j % 6;
+      RNGKey key = j % 4 ? rng_key(RNGType::Attack, player) : rng_key(RNGType::Damage, player, j);
+      checksum += rng.random(n, key);
+    }
+  }
+  auto end = high_resolution_clock::now();
+  duration<double> t = end-start;
+  cout << "Keyed rng    ns/call: " << setprecision(4) << (t.count() * 1e9 / (runs * calls)) << setprecision(5);
+  cout << "    (checksum " << checksum << ")" << endl;
+}
+
 // -----------------------------------------------------------------------------
 // Main function
 // -----------------------------------------------------------------------------
 
 int main(int argc, char const** argv) {
   Boards boards;
-  if (!load_boards("examples/benchmark-boards.txt", boards)) return 1;
+  const char* filename = argc > 1 ? argv[1] : "examples/benchmark-boards.txt";
+  if (!load_boards(filename, boards)) return 1;
   for (int rep=0; rep<3; ++rep) {
     tournament_benchmark(boards);
   }
+  for (int rep=0; rep<3; ++rep) {
+    attack_benchmark(boards);
+  }
+  for (int rep=0; rep<3; ++rep) {
+    copy_benchmark(boards);
+  }
+  for (int rep=0; rep<3; ++rep) {
+    keyed_rng_benchmark();
+  }
 }
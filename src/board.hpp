@@ -19,26 +19,58 @@ using std::max;
 const int BOARDSIZE = 7;
 const int MAX_HAND_SIZE = 10;
 const int NUM_EXTRA_POS = 3;
+static_assert(BOARDSIZE <= 8, "positions of dying minions are stored in a byte");
+
+// Total strength of the board wide auras, and counts needed for the positional auras
+// These are at most 4*BOARDSIZE, so they fit in a byte
+struct AuraTotals {
+  signed char warleader = 0;    // attack for other murlocs
+  signed char phalanx = 0;      // attack for other minions with taunt
+  signed char siegebreaker = 0; // attack for other demons
+  signed char malganis = 0;     // attack and health for other demons
+  signed char dire_wolves = 0;
+  signed char murk_eyes = 0;
+  signed char murlocs = 0;      // Old Murk-Eye counts murlocs on both boards
+
+  // add (sign=1) or remove (sign=-1) the auras of a minion, returns true if it has a board wide aura
+  bool add(Minion const& m, int sign) {
+    if (m.has_tribe(Tribe::Murloc)) murlocs += sign;
+    switch (m.type) {
+      case MinionType::MurlocWarleader:  warleader    += sign * m.double_if_golden(2); return true;
+      case MinionType::PhalanxCommander: phalanx      += sign * m.double_if_golden(2); return true;
+      case MinionType::Siegebreaker:     siegebreaker += sign * m.double_if_golden(1); return true;
+      case MinionType::MalGanis:         malganis     += sign * m.double_if_golden(2); return true;
+      case MinionType::DireWolfAlpha:    dire_wolves  += sign; return false;
+      case MinionType::OldMurkEye:       murk_eyes    += sign; return false;
+      default: return false;
+    }
+  }
+  bool any() const {
+    return warleader || phalanx || siegebreaker || malganis || dire_wolves || murk_eyes;
+  }
+};
 
 #define COMBAT_ONLY 1
 
 // Board state
+// Boards are copied for every simulated battle, so positions and counters are stored in small types:
+// the minions and positions take one cache line, everything else a second one.
 struct Board {
   MinionArray<BOARDSIZE> minions;
 
   // position of next minion to attack
-  int next_attacker = 0;
+  signed char next_attacker = 0;
   // extra positions to keep track of
   // we need enough for cleave attacks
-  int track_pos[NUM_EXTRA_POS] = {-1};
+  signed char track_pos[NUM_EXTRA_POS] = {-1};
 
   // hero power to start battle with
   HeroType hero = HeroType::None;
   bool use_hero_power = false;
   // level of the player (or 0 if unknown)
-  int level = 0;
+  short level = 0;
   // health of the player
-  int health = 0;
+  short health = 0;
   #if !COMBAT_ONLY
   // cards in hand
   std::vector<Minion> hand;
@@ -51,6 +83,19 @@ struct Board {
 private:
   // are there (possibly) any auras?
   bool any_auras = false;
+  // which events do minions (possibly) listen to? (HOOK_* flags)
+  unsigned char listeners = 0;
+  // incrementally maintained auras, see update_auras
+  AuraTotals aura_totals;
+  bool aura_all_dirty = false;      // all minions need their aura updated
+  bool aura_any_dirty = false;      // some minions have aura_dirty set
+  bool aura_full_recompute = true;  // incremental updates are not possible, use recompute_auras
+  signed char aura_enemy_murlocs = 0; // enemy murlocs at the last update
+  // positions of minions that (possibly) died since the last check_for_deaths (bitmask)
+  unsigned char dying = 0;
+  // cached has_minion() of Khadgar, Baron Rivendare and Brann Bronzebeard
+  mutable bool multipliers_valid = false;
+  mutable unsigned char have_khadgar = 0, have_rivendare = 0, have_brann = 0;
 public:
 
   Board() {}
@@ -60,7 +105,9 @@ public:
     , use_hero_power(use_hero_power)
     , level(level)
     , health(health)
-  {}
+  {
+    recompute_listeners();
+  }
 
   // Modifying minions
 
@@ -73,17 +120,32 @@ public:
     for (int i=0; i<NUM_EXTRA_POS; ++i) {
       if (pos >= track_pos[i]) track_pos[i]++;
     }
+    unsigned int below = (1u << pos) - 1;
+    dying = (dying & below) | ((dying & ~below) << 1);
+    if (minion.dead()) mark_dying(pos);
     any_auras = any_auras || is_aura_minion(minion.type) || minion.invalid_aura;
+    listeners |= event_hooks(minion.type);
+    if (is_multiplier_minion(minion.type)) invalidate_multipliers();
+    aura_inserted(pos);
     return true;
   }
 
   int append(Minion const& minion) {
     int pos = minions.append(minion);
     any_auras = any_auras || is_aura_minion(minion.type) || minion.invalid_aura;
+    listeners |= event_hooks(minion.type);
+    if (is_multiplier_minion(minion.type)) invalidate_multipliers();
+    if (pos < BOARDSIZE) {
+      if (minion.dead()) mark_dying(pos);
+      aura_inserted(pos);
+    }
     return pos;
   }
 
   void remove(int pos) {
+    if (!minions.contains(pos)) return;
+    if (is_multiplier_minion(minions[pos].type)) invalidate_multipliers();
+    aura_removed(minions[pos], pos-1, pos+1);
     minions.remove(pos);
     if (pos < next_attacker) {
       next_attacker--;
@@ -92,12 +154,52 @@ public:
       if (pos < track_pos[i]) track_pos[i]--;
       else if (pos == track_pos[i]) track_pos[i] = -1;
     }
+    unsigned int below = (1u << pos) - 1;
+    dying = (dying & below) | ((dying >> 1) & ~below);
+  }
+
+  // Dying minions
+  // Everything that can make a minion die marks its position, so check_for_deaths only has to look at these boards
+
+  void mark_dying(int pos) {
+    dying |= 1u << pos;
+  }
+  void mark_dead_minions() {
+    minions.for_each_with_pos([this](int pos, Minion const& m) {
+      if (m.dead()) mark_dying(pos);
+    });
+  }
+  bool any_dying() const {
+    return dying != 0;
+  }
+  // position of the first minion that might have died
+  int first_dying() const {
+    int pos = 0;
+    while (!(dying & (1u << pos))) pos++;
+    return pos;
+  }
+  void clear_dying() {
+    dying = 0;
+  }
+
+  // Event listeners
+  // Removing minions doesn't update the listeners, so they can be a superset, until they are recomputed
+
+  bool has_listeners(unsigned char hook) const {
+    return listeners & hook;
+  }
+  void recompute_listeners() {
+    listeners = 0;
+    minions.for_each([this](Minion const& m) {
+      listeners |= event_hooks(m.type);
+    });
   }
 
   // Targeting
   
   // target to attack
-  int random_attack_target(BattleRNG& rng, RNGKey key) const {
+  template <typename R>
+  int random_attack_target(R& rng, RNGKey key) const {
     int num_taunts = 0, num_minions = 0;
     minions.for_each([&](Minion const& m) {
       if (m.taunt) num_taunts++;
@@ -119,7 +221,8 @@ public:
   }
 
   // minion with the lowest attack
-  int lowest_attack_target(BattleRNG& rng, RNGKey key) const {
+  template <typename R>
+  int lowest_attack_target(R& rng, RNGKey key) const {
     int num_lowest = 0, lowest_attack = std::numeric_limits<int>::max();
     for (int i=0; minions.contains(i); ++i) {
       if (minions[i].attack < lowest_attack) {
@@ -138,8 +241,8 @@ public:
     return -1;
   }
 
-  template <typename P>
-  int random_minion_satisfying(P predicate, BattleRNG& rng, RNGKey key) const {
+  template <typename P, typename R>
+  int random_minion_satisfying(P predicate, R& rng, RNGKey key) const {
     int num_options = 0;
     for (int i=0; minions.contains(i); ++i) {
       if (predicate(minions[i])) {
@@ -155,7 +258,8 @@ public:
     }
     return -1;
   }
-  int random_living_minion(BattleRNG& rng, RNGKey key) const {
+  template <typename R>
+  int random_living_minion(R& rng, RNGKey key) const {
     return random_minion_satisfying([](Minion const& m) { return !m.dead(); }, rng, key);
   }
 
@@ -175,32 +279,56 @@ public:
 
   // Specific buffs
 
-  template <typename F>
-  void for_random_living_minion(F fun, BattleRNG& rng, RNGKey key) {
+  template <typename F, typename R>
+  void for_random_living_minion(F fun, R& rng, RNGKey key) {
     int i = random_living_minion(rng,key);
     if (i != -1) fun(minions[i]);
   }
-  void give_random_minion_divine_shield(BattleRNG& rng, int player) {
+  template <typename R>
+  void give_random_minion_divine_shield(R& rng, int player) {
     // Note: random minion that doesn't have divine shield
     int i = random_minion_satisfying([](Minion const& m){ return !m.dead() && !m.divine_shield; }, rng, rng_key(RNGType::GiveDivineShield,player));
     if (i != -1) {
       minions[i].divine_shield = true;
     }
   }
-  void buff_random_minion(int attack, int health, BattleRNG& rng, int player) {
+  template <typename R>
+  void buff_random_minion(int attack, int health, R& rng, int player) {
     for_random_living_minion([=](Minion& m) { m.buff(attack, health); }, rng, rng_key(RNGType::Buff,player,attack+(health<<8)));
   }
 
   // Duplication effects (Brann/Rivendare/Khadgar)
+  // These are needed for every summon and death, so they are cached.
+  // The cache must be invalidated when one of these minions is added, removed or dies.
 
+  static bool is_multiplier_minion(MinionType type) {
+    return type == MinionType::Khadgar || type == MinionType::BaronRivendare || type == MinionType::BrannBronzebeard;
+  }
+  void invalidate_multipliers() {
+    multipliers_valid = false;
+  }
+  void update_multipliers() const {
+    if (multipliers_valid) return;
+    have_khadgar = have_rivendare = have_brann = 0;
+    minions.for_each_alive([this](Minion const& m) {
+      unsigned char have = m.golden ? 2 : 1;
+      if (m.type == MinionType::Khadgar)          have_khadgar   = max(have_khadgar, have);
+      if (m.type == MinionType::BaronRivendare)   have_rivendare = max(have_rivendare, have);
+      if (m.type == MinionType::BrannBronzebeard) have_brann     = max(have_brann, have);
+    });
+    multipliers_valid = true;
+  }
   int extra_summon_count() const {
-    return has_minion(MinionType::Khadgar) + 1;
+    update_multipliers();
+    return have_khadgar + 1;
   }
   int extra_deathrattle_count() const {
-    return has_minion(MinionType::BaronRivendare) + 1;
+    update_multipliers();
+    return have_rivendare + 1;
   }
   int extra_battlecry_count() const {
-    return has_minion(MinionType::BrannBronzebeard) + 1;
+    update_multipliers();
+    return have_brann + 1;
   }
   // is the minion present? return 0 if not, 1 if yes, 2 if golden
   int has_minion(MinionType type) const {
@@ -234,8 +362,32 @@ public:
   }
 
   // Auras
+  //
+  // recompute_auras clears all aura buffs and recomputes them from scratch.
+  // Alternatively, the board keeps track of the total strength of auras (AuraTotals),
+  // and which minions are affected by insertions and removals (aura_dirty).
+  // update_auras then only updates those minions.
 
   void recompute_auras(Board const* enemy_board = nullptr);
+  void update_auras(Board const* enemy_board = nullptr);
+  // the minion at pos was just inserted
+  void aura_inserted(int pos);
+  // minion m is removed, left and right are the positions of its neighbors (before removal)
+  void aura_removed(Minion const& m, int left, int right);
+  // number of murlocs on the board, including dead ones that have not been removed yet
+  int num_murlocs() const {
+    return aura_totals.murlocs;
+  }
+private:
+  void mark_aura_dirty(int pos) {
+    if (minions.contains(pos)) {
+      minions[pos].aura_dirty = true;
+      aura_any_dirty = true;
+    }
+  }
+  // the aura buff that the minion at pos should have
+  void aura_target(int pos, int enemy_murlocs, int& attack, int& health) const;
+public:
 
   template <typename Condition>
   void aura_buff_others_if(int attack, int health, int pos, Condition c) {
@@ -255,6 +407,9 @@ public:
   void on_summoned(Minion& summoned, int pos, bool played);
 };
 
+static_assert(sizeof(MinionArray<BOARDSIZE>) + NUM_EXTRA_POS + 1 <= 64, "minions and positions should fit in a cache line");
+static_assert(sizeof(Board) <= 2*64, "Board should fit in two cache lines");
+
 inline ostream& operator << (ostream& s, Board const& b) {
   if (b.level) {
     s << "level " << b.level << endl;
@@ -5,7 +5,8 @@ using std::cout;
 // Events
 // -----------------------------------------------------------------------------
 
-void Battle::do_hero_power(HeroType hp, int player) {
+template <typename Trace, typename R>
+void BasicBattle<Trace,R>::do_hero_power(HeroType hp, int player) {
   switch(hp) {
     case HeroType::None:
       break;
@@ -34,10 +35,14 @@ void Battle::do_hero_power(HeroType hp, int player) {
       break;
     case HeroType::ProfessorPutricide:
       if (board[player].minions.contains(0)) {
-        board[player].minions[0].attack += 10;
+        board[player].minions[0].buff(10, 0);
       }
       break;
     default:;
   }
 }
 
+
+#define INSTANTIATE_HERO_POWER(Trace, R) template void BasicBattle<Trace,R>::do_hero_power(HeroType, int);
+#define INSTANTIATE_HERO_POWERS(R) FOR_EACH_TRACE(INSTANTIATE_HERO_POWER, R)
+FOR_EACH_RNG(INSTANTIATE_HERO_POWERS)
@@ -11,24 +11,23 @@ using namespace std;
 // Simulation stuff
 // -----------------------------------------------------------------------------
 
-void print_stats(ostream& out, ScoreSummary const& stats, vector<int> const& results) {
+void print_stats(ostream& out, ScoreSummary const& stats) {
   out << "win: " << percentage(stats.win_rate(0)) << ", ";
   out << "tie: " << percentage(stats.draw_rate()) << ", ";
   out << "lose: " << percentage(stats.win_rate(1)) << endl;
   out.precision(3);
   out << "mean score: " << stats.mean_score();
-  out << ", median score: " << results[results.size()/2] << endl;
+  out << ", median score: " << stats.scores.quantile(0.5) << endl;
   int steps = 10;
-  int n = (int)results.size() - 1;
   out << "percentiles: ";
   for (int i=0; i <= steps; ++i) {
-    out << results[i*(n-1)/steps] << " ";
+    out << stats.scores.quantile((double)i/steps) << " ";
   }
   out << endl;
 }
 
-void print_outcome_percentile(ostream& out, int outcome, vector<int> const& results) {
-  int p = percentile(outcome,results);
+void print_outcome_percentile(ostream& out, int outcome, ScoreSummary const& stats) {
+  int p = percentile(outcome,stats.scores);
   out << "actual outcome: " << outcome << ", is at the " << p << "-th percentile"
       << (p < 15 ? ", you got unlucky" : p > 85 ? ", you got lucky" : "") << endl;
 }
@@ -44,10 +43,9 @@ void print_damage_taken(ostream& out, ScoreSummary const& stats, int health, int
 }
 
 void do_run(ostream& out, Board players[2], int n = DEFAULT_NUM_RUNS) {
-  vector<int> results;
-  ScoreSummary stats = simulate(players[0], players[1], n, &results);
+  ScoreSummary stats = simulate(players[0], players[1], n);
   out << "--------------------------------" << endl;
-  print_stats(out, stats, results);
+  print_stats(out, stats);
   print_damage_taken(out, stats, players[0].health, 0);
   print_damage_taken(out, stats, players[1].health, 1);
   out << "--------------------------------" << endl;
@@ -153,8 +151,8 @@ Minion convert_to_minion(Entity const& entity) {
   MinionType type = to_minion_type(entity.hs_id, golden);
   golden = golden || entity.premium;
   Minion minion(type,golden);
-  minion.attack = entity.attack;
-  minion.health = entity.health;
+  minion.attack = clamp_stat(entity.attack);
+  minion.health = clamp_stat(entity.health);
   minion.invalid_aura = true; // stats include aura's
   if (entity.taunt) minion.taunt = true;
   if (entity.divine_shield) minion.divine_shield = true;
@@ -193,6 +191,8 @@ struct PreBattleState {
 
 PreBattleState to_board_state(HSGame& game) {
   PreBattleState out;
+  // minions by zone position, entities are not in order
+  Minion minions[2][BOARDSIZE];
   for (auto const& x : game.entities) {
     Entity const& e = *x.second;
     int who = game.decode_controller(e.controller);
@@ -200,7 +200,7 @@ PreBattleState to_board_state(HSGame& game) {
       if (e.type == EntityType::MINION) {
         int pos = e.zone_position - 1;
         if (pos >= 0 && pos < BOARDSIZE) {
-          out.players[who].minions[pos] = convert_to_minion(e);
+          minions[who][pos] = convert_to_minion(e);
         }
       } else if (e.type == EntityType::HERO_POWER) {
         out.players[who].use_hero_power = e.used;
@@ -211,6 +211,11 @@ PreBattleState to_board_state(HSGame& game) {
       }
     }
   }
+  for (int player=0; player<2; ++player) {
+    for (int pos=0; pos<BOARDSIZE && minions[player][pos].exists(); ++pos) {
+      out.players[player].append(minions[player][pos]);
+    }
+  }
   for (int player=0; player<2; ++player) {
     out.players[player].recompute_auras(&out.players[1-player]);
   }
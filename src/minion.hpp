@@ -8,11 +8,21 @@ using std::max;
 // Minion instances
 // -----------------------------------------------------------------------------
 
-class Battle;
+template <typename Trace, typename R> struct BasicBattle;
 class Board;
 
+// Stats are stored in 12 bits, larger values are clamped
+const int MAX_STAT = 2047;
+
+inline int clamp_stat(int x) {
+  return max(-MAX_STAT, min(MAX_STAT, x));
+}
+
+// Minions are copied for every simulated battle, so they are packed into 8 bytes:
+//  first word: stats and type
+//  second word: keywords, deathrattles and auras
 struct Minion {
-  int attack : 16, health : 16;
+  int attack : 12, health : 12;
   MinionType type;
   bool golden : 1;
   bool taunt : 1, divine_shield : 1, poison : 1, windfury : 1;
@@ -22,8 +32,9 @@ struct Minion {
   unsigned deathrattle_golden_microbots : 3;
   unsigned deathrattle_plants  : 3; // from adapt
   int attack_aura : 8; // temporary buffs from auras, at most 6*4+13*4
-  int health_aura : 7;
+  int health_aura : 6; // at most 6*4 (Mal'Ganis)
   bool invalid_aura : 1; // the stats are forced to a given value which includes auras
+  bool aura_dirty : 1; // the aura buff might be out of date, see Board::update_auras
 
   constexpr Minion()
     : attack(0)
@@ -42,6 +53,7 @@ struct Minion {
     , attack_aura(0)
     , health_aura(0)
     , invalid_aura(false)
+    , aura_dirty(false)
   {}
   Minion(MinionType type, bool golden = false)
     : Minion(type, ::info(type), golden)
@@ -64,6 +76,7 @@ private:
     , attack_aura(0)
     , health_aura(0)
     , invalid_aura(false)
+    , aura_dirty(false)
   {}
 public:
 
@@ -99,13 +112,13 @@ public:
   }
 
   void buff(int attack, int health) {
-    this->attack += attack;
-    this->health += health;
+    this->attack = clamp_stat(this->attack + attack);
+    this->health = clamp_stat(this->health + health);
   }
   void buff(Minion const& b) {
     // buff by the stats of the reference minion (want b.type == None)
-    this->attack += b.attack;
-    this->health += b.health;
+    this->attack = clamp_stat(this->attack + b.attack);
+    this->health = clamp_stat(this->health + b.health);
     this->taunt = this->taunt || b.taunt;
     this->divine_shield = this->divine_shield || b.divine_shield;
     this->poison = this->poison || b.poison;
@@ -120,14 +133,20 @@ public:
   }
 
   void aura_buff(int attack, int health) {
-    this->attack += attack;
-    this->health += health;
-    this->attack_aura += attack;
-    this->health_aura += health;
+    // only the part of the buff that fits is recorded, so clearing the aura restores the stats
+    int old_attack = this->attack, old_health = this->health;
+    this->attack = clamp_stat(old_attack + attack);
+    this->health = clamp_stat(old_health + health);
+    this->attack_aura += this->attack - old_attack;
+    this->health_aura += this->health - old_health;
+  }
+  // replace the current aura buff by a new one
+  void set_aura_buff(int attack, int health) {
+    aura_buff(attack - this->attack_aura, health - this->health_aura);
   }
   void clear_aura_buff() {
-    this->attack -= this->attack_aura;
-    this->health -= this->health_aura;
+    this->attack = clamp_stat(this->attack - this->attack_aura);
+    this->health = clamp_stat(this->health - this->health_aura);
     this->attack_aura = 0;
     this->health_aura = 0;
   }
@@ -148,11 +167,11 @@ public:
 
   bool recompute_aura_from(Board& board, int pos, Board const* enemy_board = nullptr);
   void do_battlecry(Board& board, int pos, int target=-1);
-  void do_deathrattle(Battle& battle, int player, int pos) const;
+  template <typename Trace, typename R> void do_deathrattle(BasicBattle<Trace,R>& battle, int player, int pos) const;
   void on_friendly_summon(Board& board, Minion& summoned, bool played);
-  void on_friendly_death(Battle& battle, Minion const& dead_minion, int player);
-  void on_damaged(Battle& battle, int player, int pos);
-  void on_attack_and_kill(Battle& battle, int player, int pos, bool overkill);
+  template <typename Trace, typename R> void on_friendly_death(BasicBattle<Trace,R>& battle, Minion const& dead_minion, int player);
+  template <typename Trace, typename R> void on_damaged(BasicBattle<Trace,R>& battle, int player, int pos);
+  template <typename Trace, typename R> void on_attack_and_kill(BasicBattle<Trace,R>& battle, int player, int pos, bool overkill);
   void on_after_friendly_attack(Minion const& attacker);
   void on_break_friendly_divine_shield();
 
@@ -167,9 +186,27 @@ public:
     , attack_aura(0)
     , health_aura(0)
     , invalid_aura(false)
+    , aura_dirty(false)
   {}
 };
 
+// are two minions identical, including all buffs?
+inline bool operator == (Minion const& a, Minion const& b) {
+  return a.attack == b.attack && a.health == b.health
+      && a.type == b.type && a.golden == b.golden
+      && a.taunt == b.taunt && a.divine_shield == b.divine_shield && a.poison == b.poison && a.windfury == b.windfury
+      && a.reborn == b.reborn
+      && a.deathrattle_murlocs == b.deathrattle_murlocs && a.deathrattle_microbots == b.deathrattle_microbots
+      && a.deathrattle_golden_microbots == b.deathrattle_golden_microbots && a.deathrattle_plants == b.deathrattle_plants
+      && a.attack_aura == b.attack_aura && a.health_aura == b.health_aura
+      && a.invalid_aura == b.invalid_aura;
+}
+inline bool operator != (Minion const& a, Minion const& b) {
+  return !(a == b);
+}
+
+static_assert(sizeof(Minion) == 8, "Minion should fit in 8 bytes");
+
 inline ostream& operator << (ostream& s, Minion const& minion) {
   s << minion.attack << "/" << minion.health << " ";
   if (minion.golden) s << "Golden ";
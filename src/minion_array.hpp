@@ -14,14 +14,16 @@ struct MinionArray {
 private:
   // List of minions.
   // Invariants:
-  //  the first size() elements are valid, all other elements have !.exists()
+  //  the first count elements are valid, all other elements have !.exists()
+  // Minions accessed with operator[] can be modified, but they should not be made to (not) exist that way.
   Minion minions[N];
+  int count = 0;
 
 public:
   MinionArray() {}
   MinionArray(std::initializer_list<Minion> minions) {
-    for (size_t i=0; i<minions.size() && i<7; ++i) {
-      this->minions[i] = minions.begin()[i];
+    for (size_t i=0; i<minions.size() && i<N; ++i) {
+      this->minions[count++] = minions.begin()[i];
     }
   }
 
@@ -38,58 +40,55 @@ public:
   // Queries
 
   int size() const {
-    for (int i=0; i<N; ++i) {
-      if (!minions[i].exists()) return i;
-    }
-    return N;
+    return count;
   }
 
   bool empty() const {
-    return !minions[0].exists();
+    return count == 0;
   }
 
   bool full() const {
-    return minions[N-1].exists();
+    return count == N;
   }
 
   bool contains(int pos) const {
-    return pos >= 0 && pos < N && minions[pos].exists();
+    return pos >= 0 && pos < count;
   }
 
   // Modification
 
   void clear() {
-    for (int i=0; i<N; ++i) {
+    for (int i=0; i<count; ++i) {
       minions[i].clear();
     }
+    count = 0;
   }
 
   int append(Minion const& minion) {
-    for (int i=0; i<N; ++i) {
-      if (!minions[i].exists()) {
-        minions[i] = minion;
-        return i;
-      }
-    }
-    return N;
+    if (full()) return N;
+    minions[count] = minion;
+    return count++;
   }
 
   bool insert(int pos, Minion const& minion) {
     if (full()) return false;
-    std::move_backward(&minions[pos], &minions[N-1], &minions[N]);
+    std::move_backward(&minions[pos], &minions[count], &minions[count+1]);
     minions[pos] = minion;
+    count++;
     return true;
   }
 
   void remove(int pos) {
-    std::move(&minions[pos+1], &minions[N], &minions[pos]);
-    minions[N-1].clear();
+    if (pos >= count) return;
+    std::move(&minions[pos+1], &minions[count], &minions[pos]);
+    minions[--count].clear();
   }
 
   void remove_all_from(int pos) {
-    for (;pos < N && minions[pos].exists(); ++pos) {
-      minions[pos].clear();
+    for (int i=pos; i<count; ++i) {
+      minions[i].clear();
     }
+    count = std::min(count, pos);
   }
 
   // Iterators
@@ -116,20 +115,20 @@ public:
 
   template <typename F>
   void for_each(F fun) {
-    for (int i=0; i<N && minions[i].exists(); ++i) {
+    for (int i=0; i<count; ++i) {
       fun(minions[i]);
     }
   }
   template <typename F>
   void for_each(F fun) const {
-    for (int i=0; i<N && minions[i].exists(); ++i) {
+    for (int i=0; i<count; ++i) {
       fun(minions[i]);
     }
   }
 
   template <typename F>
   void for_each_alive(F fun) {
-    for (int i=0; i<N && minions[i].exists(); ++i) {
+    for (int i=0; i<count; ++i) {
       if (!minions[i].dead()) {
         fun(minions[i]);
       }
@@ -137,7 +136,7 @@ public:
   }
   template <typename F>
   void for_each_alive(F fun) const {
-    for (int i=0; i<N && minions[i].exists(); ++i) {
+    for (int i=0; i<count; ++i) {
       if (!minions[i].dead()) {
         fun(minions[i]);
       }
@@ -146,22 +145,22 @@ public:
 
   template <typename F>
   void for_each_with_pos(F fun) {
-    for (int i=0; i<N && minions[i].exists(); ++i) {
+    for (int i=0; i<count; ++i) {
       fun(i, minions[i]);
     }
   }
   template <typename F>
   void for_each_with_pos(F fun) const {
-    for (int i=0; i<N && minions[i].exists(); ++i) {
+    for (int i=0; i<count; ++i) {
       fun(i, minions[i]);
     }
   }
 
   template <typename F>
   int count_if(F fun) const {
-    int count = 0;
-    for_each([&count,fun](Minion const& m) { if (fun(m)) count++; });
-    return count;
+    int n = 0;
+    for_each([&n,fun](Minion const& m) { if (fun(m)) n++; });
+    return n;
   }
 };
 
@@ -253,9 +252,9 @@ struct MinionArray : public std::vector<Minion> {
 
   template <typename F>
   int count_if(F fun) const {
-    int count = 0;
-    for_each([&count,fun](Minion const& m) { if (fun(m)) count++; });
-    return count;
+    int n = 0;
+    for_each([&n,fun](Minion const& m) { if (fun(m)) n++; });
+    return n;
   }
 };
 
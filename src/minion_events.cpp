@@ -1,157 +1,203 @@
 #include "battle.hpp"
 
+// Each event has a handler function per minion type, named <event>_<MinionType>.
+// The minion types that have a handler are listed in enums.hpp (FOR_EACH_<EVENT>_MINION),
+// these lists are generated from the HOOK_* flags, see generate_enum_data.py.
+// Dispatching an event looks up the handler in a table indexed by minion type,
+// minions without a handler for the event are skipped.
+
+template <typename Handler>
+struct HandlerTable {
+  Handler handlers[MinionType_count] = {};
+
+  constexpr void set(MinionType type, Handler handler) {
+    handlers[static_cast<int>(type)] = handler;
+  }
+  constexpr Handler operator [] (MinionType type) const {
+    return handlers[static_cast<int>(type)];
+  }
+};
+
+#define TWICE_IF_GOLDEN() for(int i=0;i<(self.golden?2:1);++i)
+
 // -----------------------------------------------------------------------------
 // Aura buffs
 // -----------------------------------------------------------------------------
 
-bool Minion::recompute_aura_from(Board& board, int pos, Board const* enemy_board) {
-  switch (type) {
-    case MinionType::DireWolfAlpha:
-      board.aura_buff_adjacent(double_if_golden(1), 0, pos);
-      return true;
-    case MinionType::MurlocWarleader:
-      board.aura_buff_others_if(double_if_golden(2), 0, pos, [](Minion const& to){ return to.has_tribe(Tribe::Murloc); });
-      return true;
-    case MinionType::OldMurkEye: {
-      // count murlocs for both players
-      int count = pos >= 0 ? -1 : 0; // exclude self
-      count += board.minions.count_if([](Minion const& to) { return to.has_tribe(Tribe::Murloc); });
-      if (enemy_board) {
-        count += enemy_board->minions.count_if([](Minion const& to) { return to.has_tribe(Tribe::Murloc); });
-      }
-      aura_buff(double_if_golden(count),0);
-      return true;
-    }
-    case MinionType::PhalanxCommander:
-      board.aura_buff_others_if(double_if_golden(2), 0, pos, [](Minion const& to){ return to.taunt; });
-      return true;
-    case MinionType::Siegebreaker:
-      board.aura_buff_others_if(double_if_golden(1), 0, pos, [](Minion const& to){ return to.has_tribe(Tribe::Demon); });
-      return true;
-    case MinionType::MalGanis:
-      board.aura_buff_others_if(double_if_golden(2), double_if_golden(2), pos,
-        [](Minion const& to){ return to.has_tribe(Tribe::Demon); });
-      return true;
-    default:;
-      return false;
+#define AURA(T) \
+  static void aura_##T(Minion& self, Board& board, int pos, Board const* enemy_board)
+
+AURA(DireWolfAlpha) {
+  board.aura_buff_adjacent(self.double_if_golden(1), 0, pos);
+}
+AURA(MurlocWarleader) {
+  board.aura_buff_others_if(self.double_if_golden(2), 0, pos, [](Minion const& to){ return to.has_tribe(Tribe::Murloc); });
+}
+AURA(OldMurkEye) {
+  // count murlocs for both players
+  int count = pos >= 0 ? -1 : 0; // exclude self
+  count += board.minions.count_if([](Minion const& to) { return to.has_tribe(Tribe::Murloc); });
+  if (enemy_board) {
+    count += enemy_board->minions.count_if([](Minion const& to) { return to.has_tribe(Tribe::Murloc); });
   }
+  self.aura_buff(self.double_if_golden(count),0);
+}
+AURA(PhalanxCommander) {
+  board.aura_buff_others_if(self.double_if_golden(2), 0, pos, [](Minion const& to){ return to.taunt; });
+}
+AURA(Siegebreaker) {
+  board.aura_buff_others_if(self.double_if_golden(1), 0, pos, [](Minion const& to){ return to.has_tribe(Tribe::Demon); });
+}
+AURA(MalGanis) {
+  board.aura_buff_others_if(self.double_if_golden(2), self.double_if_golden(2), pos,
+    [](Minion const& to){ return to.has_tribe(Tribe::Demon); });
+}
+
+using AuraHandler = void (*)(Minion&, Board&, int, Board const*);
+
+static constexpr HandlerTable<AuraHandler> aura_handlers = [] {
+  HandlerTable<AuraHandler> table;
+  #define X(T) table.set(MinionType::T, aura_##T);
+  FOR_EACH_AURA_MINION(X)
+  #undef X
+  return table;
+}();
+
+bool Minion::recompute_aura_from(Board& board, int pos, Board const* enemy_board) {
+  auto handler = aura_handlers[type];
+  if (!handler) return false;
+  handler(*this, board, pos, enemy_board);
+  return true;
 }
 
 // -----------------------------------------------------------------------------
 // Deathrattles
 // -----------------------------------------------------------------------------
 
-#define TWICE_IF_GOLDEN() for(int i=0;i<(golden?2:1);++i)
+#define DEATHRATTLE(T) \
+  template <typename Trace, typename R> \
+  static void deathrattle_##T(Minion const& self, BasicBattle<Trace,R>& battle, int player, int pos)
 
-void Minion::do_deathrattle(Battle& battle, int player, int pos) const {
-  switch (type) {
-    // Tier 1
-    case MinionType::Mecharoo:
-      battle.summon(Minion(MinionType::JoEBot,golden), player, pos);
-      break;
-    case MinionType::SelflessHero:
-      TWICE_IF_GOLDEN() {
-        battle.board[player].give_random_minion_divine_shield(battle.rng, player);
-      }
-      break;
-    case MinionType::FiendishServant:
-      TWICE_IF_GOLDEN() {
-        battle.board[player].buff_random_minion(this->attack,0, battle.rng, player);
-      }
-      break;
-    // Tier 2
-    case MinionType::HarvestGolem:
-      battle.summon(Minion(MinionType::DamagedGolem,golden), player, pos);
-      break;
-    case MinionType::KaboomBot:
-      TWICE_IF_GOLDEN() {
-        battle.damage_random_minion(1-player, 4);
-      }
-      // don't need to call check_for_deaths();
-      break;
-    case MinionType::KindlyGrandmother:
-      battle.summon(Minion(MinionType::BigBadWolf,golden), player, pos);
-      break;
-    case MinionType::MountedRaptor:
-      TWICE_IF_GOLDEN() {
-        battle.summon(random_one_cost_minion(battle.rng, player), player, pos);
-      }
-      break;
-    case MinionType::RatPack:
-      battle.summon_many(attack, Minion(MinionType::Rat,golden), player, pos);
-      break;
-    case MinionType::SpawnOfNZoth:
-      battle.board[player].buff_all(double_if_golden(1), double_if_golden(1));
-      break;
-    case MinionType::Imprisoner:
-      battle.summon(Minion(MinionType::Imp,golden), player, pos);
-      break;
-    // Tier 3
-    case MinionType::InfestedWolf:
-      battle.summon_many(2, Minion(MinionType::Spider,golden), player, pos);
-      break;
-    case MinionType::PilotedShredder:
-      TWICE_IF_GOLDEN() {
-        battle.summon(random_two_cost_minion(battle.rng, player), player, pos);
-      }
-      break;
-    case MinionType::ReplicatingMenace:
-      battle.summon_many(3, Minion(MinionType::Microbot,golden), player, pos);
-      break;
-    case MinionType::TortollanShellraiser: {
-      int amount = double_if_golden(1);
-      battle.board[player].buff_random_minion(amount,amount,battle.rng,player);
-      break;
-    }
-    // Tier 4
-    case MinionType::PilotedSkyGolem:
-      TWICE_IF_GOLDEN() {
-        battle.summon(random_four_cost_minion(battle.rng, player), player, pos);
-      }
-      break;
-    case MinionType::TheBeast:
-      battle.summon_for_opponent(MinionType::FinkleEinhorn, player);
-      break;
-    // Tier 5
-    case MinionType::GoldrinnTheGreatWolf: {
-      int amount = double_if_golden(4);
-      battle.board[player].buff_all_if(amount, amount, [](Minion const& x){return x.has_tribe(Tribe::Beast);});
-      break;
-    }
-    case MinionType::KingBagurgle: {
-      int amount = double_if_golden(2);
-      battle.board[player].buff_all_if(amount, amount, [](Minion const& x){return x.has_tribe(Tribe::Murloc);});
-      break;
-    }
-    case MinionType::MechanoEgg:
-      battle.summon(Minion(MinionType::Robosaur,golden), player, pos);
-      break;
-    case MinionType::SatedThreshadon:
-      battle.summon_many(3, Minion(MinionType::MurlocScout,golden), player, pos);
-      break;
-    case MinionType::SavannahHighmane:
-      battle.summon_many(2, Minion(MinionType::Hyena,golden), player, pos);
-      break;
-    // Tier 6
-    case MinionType::Ghastcoiler:
-      for (int i=0; i<double_if_golden(2); ++i) {
-        battle.summon(random_deathrattle_minion(battle.rng, player), player, pos);
-      }
-      break;
-    case MinionType::KangorsApprentice:
-      for (int i=0; i<double_if_golden(2) && battle.mechs_that_died[player].contains(i); ++i) {
-        battle.summon(battle.mechs_that_died[player][i].new_copy(), player, pos);
-      }
-      break;
-    case MinionType::SneedsOldShredder:
-      TWICE_IF_GOLDEN() {
-        battle.summon(random_legendary_minion(battle.rng, player), player, pos);
-      }
-      break;
-    case MinionType::Voidlord:
-      battle.summon_many(3, Minion(MinionType::Voidwalker,golden), player, pos);
-      break;
-    default:;
+// Tier 1
+DEATHRATTLE(Mecharoo) {
+  battle.summon(Minion(MinionType::JoEBot,self.golden), player, pos);
+}
+DEATHRATTLE(SelflessHero) {
+  TWICE_IF_GOLDEN() {
+    battle.board[player].give_random_minion_divine_shield(battle.rng, player);
+  }
+}
+DEATHRATTLE(FiendishServant) {
+  TWICE_IF_GOLDEN() {
+    battle.board[player].buff_random_minion(self.attack,0, battle.rng, player);
+  }
+}
+// Tier 2
+DEATHRATTLE(HarvestGolem) {
+  battle.summon(Minion(MinionType::DamagedGolem,self.golden), player, pos);
+}
+DEATHRATTLE(KaboomBot) {
+  TWICE_IF_GOLDEN() {
+    battle.damage_random_minion(1-player, 4);
+  }
+  // don't need to call check_for_deaths();
+}
+DEATHRATTLE(KindlyGrandmother) {
+  battle.summon(Minion(MinionType::BigBadWolf,self.golden), player, pos);
+}
+DEATHRATTLE(MountedRaptor) {
+  TWICE_IF_GOLDEN() {
+    battle.summon(random_one_cost_minion(battle.rng, player), player, pos);
+  }
+}
+DEATHRATTLE(RatPack) {
+  battle.summon_many(self.attack, Minion(MinionType::Rat,self.golden), player, pos);
+}
+DEATHRATTLE(SpawnOfNZoth) {
+  battle.board[player].buff_all(self.double_if_golden(1), self.double_if_golden(1));
+}
+DEATHRATTLE(Imprisoner) {
+  battle.summon(Minion(MinionType::Imp,self.golden), player, pos);
+}
+// Tier 3
+DEATHRATTLE(InfestedWolf) {
+  battle.summon_many(2, Minion(MinionType::Spider,self.golden), player, pos);
+}
+DEATHRATTLE(PilotedShredder) {
+  TWICE_IF_GOLDEN() {
+    battle.summon(random_two_cost_minion(battle.rng, player), player, pos);
+  }
+}
+DEATHRATTLE(ReplicatingMenace) {
+  battle.summon_many(3, Minion(MinionType::Microbot,self.golden), player, pos);
+}
+DEATHRATTLE(TortollanShellraiser) {
+  int amount = self.double_if_golden(1);
+  battle.board[player].buff_random_minion(amount,amount,battle.rng,player);
+}
+// Tier 4
+DEATHRATTLE(PilotedSkyGolem) {
+  TWICE_IF_GOLDEN() {
+    battle.summon(random_four_cost_minion(battle.rng, player), player, pos);
+  }
+}
+DEATHRATTLE(TheBeast) {
+  battle.summon_for_opponent(MinionType::FinkleEinhorn, player);
+}
+// Tier 5
+DEATHRATTLE(GoldrinnTheGreatWolf) {
+  int amount = self.double_if_golden(4);
+  battle.board[player].buff_all_if(amount, amount, [](Minion const& x){return x.has_tribe(Tribe::Beast);});
+}
+DEATHRATTLE(KingBagurgle) {
+  int amount = self.double_if_golden(2);
+  battle.board[player].buff_all_if(amount, amount, [](Minion const& x){return x.has_tribe(Tribe::Murloc);});
+}
+DEATHRATTLE(MechanoEgg) {
+  battle.summon(Minion(MinionType::Robosaur,self.golden), player, pos);
+}
+DEATHRATTLE(SatedThreshadon) {
+  battle.summon_many(3, Minion(MinionType::MurlocScout,self.golden), player, pos);
+}
+DEATHRATTLE(SavannahHighmane) {
+  battle.summon_many(2, Minion(MinionType::Hyena,self.golden), player, pos);
+}
+// Tier 6
+DEATHRATTLE(Ghastcoiler) {
+  for (int i=0; i<self.double_if_golden(2); ++i) {
+    battle.summon(random_deathrattle_minion(battle.rng, player), player, pos);
+  }
+}
+DEATHRATTLE(KangorsApprentice) {
+  for (int i=0; i<self.double_if_golden(2) && battle.mechs_that_died[player].contains(i); ++i) {
+    battle.summon(battle.mechs_that_died[player][i].new_copy(), player, pos);
+  }
+}
+DEATHRATTLE(SneedsOldShredder) {
+  TWICE_IF_GOLDEN() {
+    battle.summon(random_legendary_minion(battle.rng, player), player, pos);
+  }
+}
+DEATHRATTLE(Voidlord) {
+  battle.summon_many(3, Minion(MinionType::Voidwalker,self.golden), player, pos);
+}
+
+template <typename Trace, typename R>
+using DeathrattleHandler = void (*)(Minion const&, BasicBattle<Trace,R>&, int, int);
+
+template <typename Trace, typename R>
+static constexpr HandlerTable<DeathrattleHandler<Trace,R>> deathrattle_handlers = [] {
+  HandlerTable<DeathrattleHandler<Trace,R>> table;
+  #define X(T) table.set(MinionType::T, deathrattle_##T<Trace,R>);
+  FOR_EACH_DEATHRATTLE_MINION(X)
+  #undef X
+  return table;
+}();
+
+template <typename Trace, typename R>
+void Minion::do_deathrattle(BasicBattle<Trace,R>& battle, int player, int pos) const {
+  if (auto handler = deathrattle_handlers<Trace,R>[type]) {
+    handler(*this, battle, player, pos);
   }
   // extra deathrattles
   battle.summon_many(deathrattle_murlocs, MinionType::MurlocScout, player, pos);
@@ -164,118 +210,214 @@ void Minion::do_deathrattle(Battle& battle, int player, int pos) const {
 // Events
 // -----------------------------------------------------------------------------
 
+#define FRIENDLY_SUMMON(T) \
+  static void friendly_summon_##T(Minion& self, Board& board, Minion& summoned, bool played)
+
+FRIENDLY_SUMMON(MurlocTidecaller) {
+  if (summoned.has_tribe(Tribe::Murloc)) {
+    self.buff(self.double_if_golden(1), 0);
+  }
+}
+FRIENDLY_SUMMON(WrathWeaver) {
+  if (played) {
+    if (summoned.has_tribe(Tribe::Demon)) {
+      // TODO: damage hero
+      self.buff(self.double_if_golden(2), self.double_if_golden(2));
+    }
+  }
+}
+FRIENDLY_SUMMON(CobaltGuardian) {
+  if (summoned.has_tribe(Tribe::Mech)) {
+    self.divine_shield = true;
+  }
+}
+FRIENDLY_SUMMON(CrowdFavorite) {
+  if (played) {
+    if (summoned.info().battlecry) {
+      self.buff(self.double_if_golden(1), self.double_if_golden(1));
+    }
+  }
+}
+FRIENDLY_SUMMON(PackLeader) {
+  if (summoned.has_tribe(Tribe::Beast)) {
+    summoned.buff(self.double_if_golden(3), 0);
+  }
+}
+FRIENDLY_SUMMON(MamaBear) {
+  if (summoned.has_tribe(Tribe::Beast)) {
+    summoned.buff(self.double_if_golden(4), self.double_if_golden(4));
+  }
+}
+FRIENDLY_SUMMON(PreNerfMamaBear) {
+  if (summoned.has_tribe(Tribe::Beast)) {
+    summoned.buff(self.double_if_golden(5), self.double_if_golden(5));
+  }
+}
+
+using FriendlySummonHandler = void (*)(Minion&, Board&, Minion&, bool);
+
+static constexpr HandlerTable<FriendlySummonHandler> friendly_summon_handlers = [] {
+  HandlerTable<FriendlySummonHandler> table;
+  #define X(T) table.set(MinionType::T, friendly_summon_##T);
+  FOR_EACH_FRIENDLY_SUMMON_MINION(X)
+  #undef X
+  return table;
+}();
+
 void Minion::on_friendly_summon(Board& board, Minion& summoned, bool played) {
-  switch (type) {
-    case MinionType::MurlocTidecaller:
-      if (summoned.has_tribe(Tribe::Murloc)) {
-        buff(double_if_golden(1), 0);
-      }
-      break;
-    case MinionType::WrathWeaver:
-      if (played) {
-        if (summoned.has_tribe(Tribe::Demon)) {
-          // TODO: damage hero
-          buff(double_if_golden(2), double_if_golden(2));
-        }
-      }
-      break;
-    case MinionType::CobaltGuardian:
-      if (summoned.has_tribe(Tribe::Mech)) {
-        divine_shield = true;
-      }
-      break;
-    case MinionType::CrowdFavorite:
-      if (played) {
-        if (summoned.info().battlecry) {
-          buff(double_if_golden(1), double_if_golden(1));
-        }
-      }
-      break;
-    case MinionType::PackLeader:
-      if (summoned.has_tribe(Tribe::Beast)) {
-        summoned.buff(double_if_golden(3), 0);
-      }
-      break;
-    case MinionType::MamaBear:
-      if (summoned.has_tribe(Tribe::Beast)) {
-        summoned.buff(double_if_golden(4), double_if_golden(4));
-      }
-      break;
-    case MinionType::PreNerfMamaBear:
-      if (summoned.has_tribe(Tribe::Beast)) {
-        summoned.buff(double_if_golden(5), double_if_golden(5));
-      }
-      break;
-    default:;
+  if (auto handler = friendly_summon_handlers[type]) {
+    handler(*this, board, summoned, played);
   }
 }
 
-void Minion::on_friendly_death(Battle& battle, Minion const& dead_minion, int player) {
-  switch (type) {
-    case MinionType::ScavengingHyena:
-      if (dead_minion.has_tribe(Tribe::Beast)) {
-        buff(double_if_golden(2), double_if_golden(1));
-      }
-      break;
-    case MinionType::SoulJuggler:
-      if (dead_minion.has_tribe(Tribe::Demon)) {
-        TWICE_IF_GOLDEN() {
-          battle.damage_random_minion(1-player, 3);
-        }
-        // already in a loop that does check_for_deaths();
-      }
-      break;
-    case MinionType::Junkbot:
-      if (dead_minion.has_tribe(Tribe::Mech)) {
-        buff(double_if_golden(2), double_if_golden(2));
-      }
-      break;
-    default:;
+#define FRIENDLY_DEATH(T) \
+  template <typename Trace, typename R> \
+  static void friendly_death_##T(Minion& self, BasicBattle<Trace,R>& battle, Minion const& dead_minion, int player)
+
+FRIENDLY_DEATH(ScavengingHyena) {
+  if (dead_minion.has_tribe(Tribe::Beast)) {
+    self.buff(self.double_if_golden(2), self.double_if_golden(1));
+  }
+}
+FRIENDLY_DEATH(SoulJuggler) {
+  if (dead_minion.has_tribe(Tribe::Demon)) {
+    TWICE_IF_GOLDEN() {
+      battle.damage_random_minion(1-player, 3);
+    }
+    // already in a loop that does check_for_deaths();
+  }
+}
+FRIENDLY_DEATH(Junkbot) {
+  if (dead_minion.has_tribe(Tribe::Mech)) {
+    self.buff(self.double_if_golden(2), self.double_if_golden(2));
   }
 }
 
-void Minion::on_damaged(Battle& battle, int player, int pos) {
-  switch (type) {
-    case MinionType::ImpGangBoss:
-      // Note: summons to the right
-      battle.summon(Minion(MinionType::Imp,golden), player, pos+1);
-      break;
-    case MinionType::SecurityRover:
-      battle.summon(Minion(MinionType::GuardBot,golden), player, pos+1);
-      break;
-    default:;
+template <typename Trace, typename R>
+using FriendlyDeathHandler = void (*)(Minion&, BasicBattle<Trace,R>&, Minion const&, int);
+
+template <typename Trace, typename R>
+static constexpr HandlerTable<FriendlyDeathHandler<Trace,R>> friendly_death_handlers = [] {
+  HandlerTable<FriendlyDeathHandler<Trace,R>> table;
+  #define X(T) table.set(MinionType::T, friendly_death_##T<Trace,R>);
+  FOR_EACH_FRIENDLY_DEATH_MINION(X)
+  #undef X
+  return table;
+}();
+
+template <typename Trace, typename R>
+void Minion::on_friendly_death(BasicBattle<Trace,R>& battle, Minion const& dead_minion, int player) {
+  if (auto handler = friendly_death_handlers<Trace,R>[type]) {
+    handler(*this, battle, dead_minion, player);
   }
 }
 
-void Minion::on_attack_and_kill(Battle& battle, int player, int pos, bool overkill) {
-  switch (type) {
-    case MinionType::IronhideDirehorn:
-      if (overkill) {
-        battle.summon(Minion(MinionType::IronhideRunt, golden), player, pos+1);
-      }
-      break;
-    case MinionType::TheBoogeymonster:
-      buff(double_if_golden(2),double_if_golden(2));
-      break;
-    default:;
+#define DAMAGED(T) \
+  template <typename Trace, typename R> \
+  static void damaged_##T(Minion& self, BasicBattle<Trace,R>& battle, int player, int pos)
+
+DAMAGED(ImpGangBoss) {
+  // Note: summons to the right
+  battle.summon(Minion(MinionType::Imp,self.golden), player, pos+1);
+}
+DAMAGED(SecurityRover) {
+  battle.summon(Minion(MinionType::GuardBot,self.golden), player, pos+1);
+}
+
+template <typename Trace, typename R>
+using DamagedHandler = void (*)(Minion&, BasicBattle<Trace,R>&, int, int);
+
+template <typename Trace, typename R>
+static constexpr HandlerTable<DamagedHandler<Trace,R>> damaged_handlers = [] {
+  HandlerTable<DamagedHandler<Trace,R>> table;
+  #define X(T) table.set(MinionType::T, damaged_##T<Trace,R>);
+  FOR_EACH_DAMAGED_MINION(X)
+  #undef X
+  return table;
+}();
+
+template <typename Trace, typename R>
+void Minion::on_damaged(BasicBattle<Trace,R>& battle, int player, int pos) {
+  if (auto handler = damaged_handlers<Trace,R>[type]) {
+    handler(*this, battle, player, pos);
+  }
+}
+
+#define ATTACK_AND_KILL(T) \
+  template <typename Trace, typename R> \
+  static void attack_and_kill_##T(Minion& self, BasicBattle<Trace,R>& battle, int player, int pos, bool overkill)
+
+ATTACK_AND_KILL(IronhideDirehorn) {
+  if (overkill) {
+    battle.summon(Minion(MinionType::IronhideRunt, self.golden), player, pos+1);
+  }
+}
+ATTACK_AND_KILL(TheBoogeymonster) {
+  self.buff(self.double_if_golden(2),self.double_if_golden(2));
+}
+
+template <typename Trace, typename R>
+using AttackAndKillHandler = void (*)(Minion&, BasicBattle<Trace,R>&, int, int, bool);
+
+template <typename Trace, typename R>
+static constexpr HandlerTable<AttackAndKillHandler<Trace,R>> attack_and_kill_handlers = [] {
+  HandlerTable<AttackAndKillHandler<Trace,R>> table;
+  #define X(T) table.set(MinionType::T, attack_and_kill_##T<Trace,R>);
+  FOR_EACH_ATTACK_AND_KILL_MINION(X)
+  #undef X
+  return table;
+}();
+
+template <typename Trace, typename R>
+void Minion::on_attack_and_kill(BasicBattle<Trace,R>& battle, int player, int pos, bool overkill) {
+  if (auto handler = attack_and_kill_handlers<Trace,R>[type]) {
+    handler(*this, battle, player, pos, overkill);
   }
 }
 
+#define AFTER_FRIENDLY_ATTACK(T) \
+  static void after_friendly_attack_##T(Minion& self, Minion const& attacker)
+
+AFTER_FRIENDLY_ATTACK(FesterootHulk) {
+  self.buff(self.double_if_golden(1),0);
+}
+
+using AfterFriendlyAttackHandler = void (*)(Minion&, Minion const&);
+
+static constexpr HandlerTable<AfterFriendlyAttackHandler> after_friendly_attack_handlers = [] {
+  HandlerTable<AfterFriendlyAttackHandler> table;
+  #define X(T) table.set(MinionType::T, after_friendly_attack_##T);
+  FOR_EACH_AFTER_FRIENDLY_ATTACK_MINION(X)
+  #undef X
+  return table;
+}();
+
 void Minion::on_after_friendly_attack(Minion const& attacker) {
-  switch (type) {
-    case MinionType::FesterootHulk:
-      buff(double_if_golden(1),0);
-      break;
-    default:;
+  if (auto handler = after_friendly_attack_handlers[type]) {
+    handler(*this, attacker);
   }
 }
 
+#define BREAK_FRIENDLY_DIVINE_SHIELD(T) \
+  static void break_friendly_divine_shield_##T(Minion& self)
+
+BREAK_FRIENDLY_DIVINE_SHIELD(BolvarFireblood) {
+  self.buff(self.double_if_golden(2),0);
+}
+
+using BreakFriendlyDivineShieldHandler = void (*)(Minion&);
+
+static constexpr HandlerTable<BreakFriendlyDivineShieldHandler> break_friendly_divine_shield_handlers = [] {
+  HandlerTable<BreakFriendlyDivineShieldHandler> table;
+  #define X(T) table.set(MinionType::T, break_friendly_divine_shield_##T);
+  FOR_EACH_BREAK_FRIENDLY_DIVINE_SHIELD_MINION(X)
+  #undef X
+  return table;
+}();
+
 void Minion::on_break_friendly_divine_shield() {
-  switch (type) {
-    case MinionType::BolvarFireblood:
-      buff(double_if_golden(2),0);
-      break;
-    default:;
+  if (auto handler = break_friendly_divine_shield_handlers[type]) {
+    handler(*this);
   }
 }
 
@@ -300,3 +442,15 @@ Tribe Minion::battlecry_target() const {
   }
 }
 
+
+// -----------------------------------------------------------------------------
+// Instantiations
+// -----------------------------------------------------------------------------
+
+#define INSTANTIATE_EVENTS(Trace, R) \
+  template void Minion::do_deathrattle(BasicBattle<Trace,R>&, int, int) const; \
+  template void Minion::on_friendly_death(BasicBattle<Trace,R>&, Minion const&, int); \
+  template void Minion::on_damaged(BasicBattle<Trace,R>&, int, int); \
+  template void Minion::on_attack_and_kill(BasicBattle<Trace,R>&, int, int, bool);
+#define INSTANTIATE_ALL_EVENTS(R) FOR_EACH_TRACE(INSTANTIATE_EVENTS, R)
+FOR_EACH_RNG(INSTANTIATE_ALL_EVENTS)
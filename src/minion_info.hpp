@@ -31,6 +31,17 @@ constexpr int double_if_golden(int x, bool golden) {
   return golden ? 2*x : x;
 }
 
+// Events that a minion type has a handler for (bitmask), see minion_events.cpp
+const unsigned char HOOK_FRIENDLY_SUMMON               = 1 << 0;
+const unsigned char HOOK_FRIENDLY_DEATH                = 1 << 1;
+const unsigned char HOOK_AFTER_FRIENDLY_ATTACK         = 1 << 2;
+const unsigned char HOOK_BREAK_FRIENDLY_DIVINE_SHIELD  = 1 << 3;
+// Events of the minion itself
+const unsigned char HOOK_DEATHRATTLE                   = 1 << 4;
+const unsigned char HOOK_DAMAGED                       = 1 << 5;
+const unsigned char HOOK_ATTACK_AND_KILL               = 1 << 6;
+const unsigned char HOOK_AURA                          = 1 << 7;
+
 // Minion info
 struct MinionInfo {
   const char* name;
@@ -41,6 +52,7 @@ struct MinionInfo {
   bool taunt, divine_shield, poison, windfury, cleave;
   bool battlecry;
   bool in_minion_pool;
+  unsigned char hooks; // HOOK_* flags
 
   constexpr int attack_for(bool golden) const {
     return double_if_golden(attack, golden);
@@ -63,24 +75,20 @@ inline const char* name(MinionType type) { return info(type).name; }
 inline Tribe tribe(MinionType type) { return info(type).tribe; }
 inline bool has_tribe(MinionType type, Tribe query) { return has_tribe(tribe(type), query); }
 inline int stars(MinionType type) { return info(type).stars; }
+inline unsigned char event_hooks(MinionType type) { return info(type).hooks; }
 
-// random minion spawning
+// random minion spawning, instantiated for each rng type in FOR_EACH_RNG
 
-MinionType random_one_cost_minion(BattleRNG& rng, int player);
-MinionType random_two_cost_minion(BattleRNG& rng, int player);
-MinionType random_four_cost_minion(BattleRNG& rng, int player);
-MinionType random_deathrattle_minion(BattleRNG& rng, int player);
-MinionType random_legendary_minion(BattleRNG& rng, int player);
+template <typename R> MinionType random_one_cost_minion(R& rng, int player);
+template <typename R> MinionType random_two_cost_minion(R& rng, int player);
+template <typename R> MinionType random_four_cost_minion(R& rng, int player);
+template <typename R> MinionType random_deathrattle_minion(R& rng, int player);
+template <typename R> MinionType random_legendary_minion(R& rng, int player);
 
 // additional info
 
-constexpr bool is_aura_minion(MinionType t) {
-  return t == MinionType::DireWolfAlpha
-      || t == MinionType::MurlocWarleader
-      || t == MinionType::OldMurkEye
-      || t == MinionType::PhalanxCommander
-      || t == MinionType::Siegebreaker
-      || t == MinionType::MalGanis;
+inline bool is_aura_minion(MinionType t) {
+  return event_hooks(t) & HOOK_AURA;
 }
 
 // -----------------------------------------------------------------------------
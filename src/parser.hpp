@@ -115,6 +115,15 @@ struct StringParser {
       return false;
     }
   }
+  bool match_double(double& out) {
+    int n = 0;
+    if (sscanf(str, "%lf%n", &out, &n) >= 1) {
+      str += n;
+      return true;
+    } else {
+      return false;
+    }
+  }
   bool match_string(std::string& out, char end=0, bool allow_empty=true) {
     const char* after = str;
     while (*after && *after != end) ++after;
@@ -186,6 +195,13 @@ struct StringParser {
     expected("positive number");
     return false;
   }
+  bool parse_positive(double& out) {
+    const char* at = str;
+    if (match_double(out) && out > 0) return true;
+    str = at;
+    expected("positive number");
+    return false;
+  }
   bool parse_non_negative(int& out) {
     const char* at = str;
     if (match_int(out) && out >= 0) return true;
@@ -286,6 +302,42 @@ bool parse_hero_type(StringParser& in, HeroType& out) {
   return true;
 }
 
+bool match_rng_policy(StringParser& in, RNGPolicy& out) {
+  for (int i=0; i < NUM_RNG_POLICIES; ++i) {
+    if (in.match(name(static_cast<RNGPolicy>(i)))) {
+      out = static_cast<RNGPolicy>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parse_rng_policy(StringParser& in, RNGPolicy& out) {
+  if (!match_rng_policy(in,out)) {
+    in.unknown("rng");
+    return false;
+  }
+  return true;
+}
+
+bool match_first_player_sampling(StringParser& in, FirstPlayerSampling& out) {
+  for (int i=0; i < NUM_FIRST_PLAYER_SAMPLINGS; ++i) {
+    if (in.match(name(static_cast<FirstPlayerSampling>(i)))) {
+      out = static_cast<FirstPlayerSampling>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parse_first_player_sampling(StringParser& in, FirstPlayerSampling& out) {
+  if (!match_first_player_sampling(in,out)) {
+    in.unknown("first player sampling");
+    return false;
+  }
+  return true;
+}
+
 bool parse_objective(StringParser& in, Objective& out) {
   if (!match_objective(in,out)) {
     in.unknown("objective");
@@ -397,8 +449,8 @@ bool parse_minion(StringParser& in, Minion& m) {
   // construct
   m = Minion(type, golden);
   if (attack != -1) {
-    m.attack = attack;
-    m.health = health;
+    m.attack = clamp_stat(attack);
+    m.health = clamp_stat(health);
     m.invalid_aura = true;
   }
   // buff?
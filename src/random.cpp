@@ -63,6 +63,7 @@ uint64_t RNG::next() {
 
 void RNG::jump() {
 	static const uint64_t JUMP[] = { 0xdf900294d8f554a5, 0x170865df4b3201fc };
+	has_spare = false;
 
 	uint64_t s0 = 0;
 	uint64_t s1 = 0;
@@ -87,6 +88,7 @@ void RNG::jump() {
 
 void RNG::long_jump() {
 	static const uint64_t LONG_JUMP[] = { 0xd2a98b26625eee7b, 0xdddf9b1090aa7ac1 };
+	has_spare = false;
 
 	uint64_t s0 = 0;
 	uint64_t s1 = 0;
@@ -103,6 +105,42 @@ void RNG::long_jump() {
 	s[1] = s1;
 }
 
+// -----------------------------------------------------------------------------
+// Bounded random numbers
+// -----------------------------------------------------------------------------
+
+uint64_t RNG::random_large(uint64_t range) {
+  // reject the values in the last partial copy of [0,range)
+  uint64_t threshold = -range % range;
+  uint64_t x;
+  do {
+    x = next();
+  } while (x < threshold);
+  return x % range;
+}
+
+// -----------------------------------------------------------------------------
+// Random streams
+// -----------------------------------------------------------------------------
+
+// splitmix64, as recommended for seeding xoroshiro
+static inline uint64_t splitmix64(uint64_t& x) {
+	uint64_t z = (x += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+RNG RNG::stream(uint64_t seed, uint64_t index) {
+  uint64_t x = seed;
+  uint64_t y = splitmix64(x) ^ index;
+  uint64_t state[2];
+  state[0] = splitmix64(y);
+  state[1] = splitmix64(y);
+  if (state[0] == 0 && state[1] == 0) state[1] = 1; // state must not be all zero
+  return RNG(state);
+}
+
 // -----------------------------------------------------------------------------
 // Low variance RNG
 // -----------------------------------------------------------------------------
@@ -113,26 +151,38 @@ int LowVarianceRNG::random(int n) {
     // don't keep subdividing
     return rng.random(n);
   } else {
-    if (cur->children.empty()) {
-      // initialize children
-      cur->i = n;
+    if (cur < 0) {
+      if (memory_used() + sizeof(Node) + n * sizeof(Entry) > memory_limit) {
+        // out of memory, stop growing the tree, and leave it for the rest of this run
+        // (a later smaller node would otherwise be linked below the wrong entry)
+        parent_entry = -1;
+        budget = 0;
+        return rng.random(n);
+      }
+      // create node and its children
+      cur = (int)storage.nodes.size();
+      storage.nodes.push_back({n, n, (int)storage.entries.size()});
       for (int i=0; i<n; ++i) {
-        cur->children.emplace_back(new Entry(i));
+        storage.entries.push_back({i, -1});
       }
-    } else if (cur->children.size() != (size_t)n) {
+      if (parent_entry >= 0) storage.entries[parent_entry].node = cur;
+    }
+    Node& node = storage.nodes[cur];
+    if (node.n != n) {
       //std::cerr << "requesting different random number range than previous runs" << std::endl;
       return rng.random(n);
     }
-    if (cur->i >= cur->children.size()) {
+    if (node.i >= n) {
       // reshuffle children
-      rng.shuffle(cur->children);
-      cur->i = 0;
+      rng.shuffle(&storage.entries[node.first], n);
+      node.i = 0;
     }
     // take next item from permutation
-    Entry& e = *cur->children[cur->i++];
-    cur = &e.tree;
+    int e = node.first + node.i++;
+    parent_entry = e;
+    cur = storage.entries[e].node;
     budget /= n; // decrease budget
-    return e.value;
+    return storage.entries[e].value;
   }
 }
 
@@ -190,43 +240,82 @@ namespace std {
 }
 
 template <typename Key>
-size_t KeyedRNG<Key>::HeaderHash::operator()(KeyedRNG<Key>::Header const& x) const noexcept {
+static inline size_t slot_hash(Key key, int n) {
   size_t seed = 0;
-  hash_combine(seed, x.key);
-  hash_combine(seed, x.n);
-  return seed;
+  hash_combine(seed, key);
+  hash_combine(seed, n);
+  // spread the bits, since we only use the low bits as index
+  return (size_t)(((uint64_t)seed * 0x9e3779b97f4a7c15u) >> 32);
+}
+
+template <typename Key>
+typename KeyedRNG<Key>::Slot& KeyedRNG<Key>::find(Key key, int n) {
+  size_t mask = slots.size() - 1;
+  for (size_t i = slot_hash(key,n) & mask; ; i = (i+1) & mask) {
+    Slot& slot = slots[i];
+    if (slot.n == n && slot.key == key) return slot;
+    if (slot.n == 0) {
+      if (2 * (num_used_slots + 1) > (int)slots.size()) {
+        grow();
+        return find(key, n);
+      }
+      slot.key = key;
+      slot.n = n;
+      slot.run = run;
+      num_used_slots++;
+      return slot;
+    }
+  }
 }
 
 template <typename Key>
-void KeyedRNG<Key>::start() {
-  for (auto& entry : table) {
-    entry.second.times_used = 0;
+void KeyedRNG<Key>::grow() {
+  std::vector<Slot> old_slots(2 * slots.size());
+  std::swap(slots, old_slots);
+  size_t mask = slots.size() - 1;
+  for (Slot const& old : old_slots) {
+    if (old.n == 0) continue;
+    size_t i = slot_hash(old.key, old.n) & mask;
+    while (slots[i].n != 0) i = (i+1) & mask;
+    slots[i] = old;
   }
 }
 
 template <typename Key>
 int KeyedRNG<Key>::random(int n, Key key) {
   if (n <= 1) return 0;
-  KeyEntry& ke = table[{key,n}];
-  size_t times_used = ke.times_used++;
-  if (times_used >= ke.entries.size()) {
-    Entry new_entry;
-    new_entry.perm.reserve(n);
-    for (int i=0; i<n; ++i) {
-      new_entry.perm.push_back(i);
+  Slot& slot = find(key, n);
+  if (slot.run != run) {
+    // first use in this run
+    slot.run = run;
+    slot.cur = slot.first;
+  }
+  if (slot.cur < 0) {
+    if (slot.count >= MAX_PERMUTATIONS) {
+      // this key is used too often, don't keep track of it
+      return rng.random(n);
     }
-    new_entry.i = n;
-    ke.entries.emplace_back(std::move(new_entry));
-    if (times_used > 30) {
-      exit(1);
+    // allocate a new permutation
+    int p = (int)arena.size();
+    arena.push_back(n);
+    arena.push_back(-1);
+    for (int i=0; i<n; ++i) {
+      arena.push_back(i);
     }
+    if (slot.last >= 0) arena[slot.last + 1] = p;
+    else slot.first = p;
+    slot.last = p;
+    slot.count++;
+    slot.cur = p;
   }
-  Entry& e = ke.entries[times_used];
-  if (e.i >= n) {
-    rng.shuffle(e.perm);
-    e.i = 0;
+  int p = slot.cur;
+  slot.cur = arena[p + 1];
+  int* perm = &arena[p + PERM_HEADER];
+  if (arena[p] >= n) {
+    rng.shuffle(perm, n);
+    arena[p] = 0;
   }
-  return e.perm[e.i++];
+  return perm[arena[p]++];
 }
 
 template class KeyedRNG<RNGKey>;
@@ -237,8 +326,7 @@ template class KeyedRNG<RNGKey>;
 
 RNG global_rng;
 
-#if LOW_VARIANCE_RNG
-BattleRNG global_battle_rng(global_rng,0);
-#elif KEYED_RNG
+RNGPolicy battle_rng_policy = RNGPolicy::Keyed;
 BattleRNG global_battle_rng(global_rng);
-#endif
+FastLowVarianceRNG global_low_variance_rng(global_rng,0);
+LowVarianceRNG global_low_variance_tree_rng(global_rng,0);
@@ -3,31 +3,69 @@
 #include <cstdint>
 #include <utility>
 #include <vector>
-#include <unordered_map>
-#include <memory>
+#include <functional>
 
 // -----------------------------------------------------------------------------
 // Random number generator
 // -----------------------------------------------------------------------------
 
+// Bounded random numbers use 32 bit outputs, each 64 bit output of the generator gives two of them.
 class RNG {
 private:
   uint64_t s[2] = {1234567891234567890u,9876543210987654321u};
+  uint32_t spare = 0;     // unused low half of the last output
+  bool has_spare = false;
+
+  // bounded random number for range > 2^32
+  uint64_t random_large(uint64_t range);
 public:
   RNG() {}
   RNG(uint64_t s[2]) : s{s[0],s[1]} {}
 
+  // full 64 bit output, doesn't use the spare half
   uint64_t next();
   void jump();
   void long_jump();
 
+  // The high half comes first, since the lowest bits of xoroshiro128+ are the weakest.
+  inline uint32_t next32() {
+    if (has_spare) {
+      has_spare = false;
+      return spare;
+    }
+    uint64_t x = next();
+    spare = (uint32_t)x;
+    has_spare = true;
+    return (uint32_t)(x >> 32);
+  }
+
+  // The index-th independent random stream for a given seed.
+  // Streams are derived by hashing (seed,index), so any stream can be created directly,
+  // without stepping through the streams before it.
+  static RNG stream(uint64_t seed, uint64_t index);
+
+  // Unbiased random number in [0,range), using Lemire's multiply-shift with rejection:
+  // the high half of x*range is the result, the low half detects the few x that would bias it.
+  // The slow path with a division is only taken with probability < range/2^32.
+  inline uint32_t random(uint32_t range) {
+    uint64_t m = (uint64_t)next32() * range;
+    uint32_t low = (uint32_t)m;
+    if (low < range) {
+      uint32_t threshold = (uint32_t)(-range) % range; // = 2^32 % range
+      while (low < threshold) {
+        m = (uint64_t)next32() * range;
+        low = (uint32_t)m;
+      }
+    }
+    return (uint32_t)(m >> 32);
+  }
+
   inline uint64_t random(uint64_t range) {
-    // TODO: make sure range evenly divides 2^64
-    return next() % range;
+    return range <= UINT32_MAX ? random((uint32_t)range) : random_large(range);
   }
 
   inline int random(int range) {
-    return (int)random((uint64_t)range);
+    return (int)random((uint32_t)range);
   }
 
   inline RNG next_rng() {
@@ -70,35 +108,71 @@ public:
 //
 // We keep a budget (in terms of state space size) so that the table doesn't become too large.
 // After the budget is exhausted falls back to a normal rng
+//
+// The tree is stored in two pools linked by indices:
+// a node is a random choice, its children are a contiguous block of entries, one for each possible result,
+// and each entry links to the node for the next choice after it (created on the first visit).
+// The pools can be shared between rngs that are used one after another (see Storage),
+// and there is a memory limit, after which no more nodes are created.
 class LowVarianceRNG {
-private:
-  int budget, initial_budget;
-  RNG& rng;
-  struct Entry;
-  struct Tree {
-    size_t i; // index of next child to use when visiting this node
-    std::vector<std::unique_ptr<Entry>> children;
+public:
+  struct Node {
+    int n;     // number of children
+    int i;     // index of next child to use when visiting this node
+    int first; // index of first child in entries
   };
   struct Entry {
     int value;
-    Tree tree;
-    Entry(int v) : value(v) {}
+    int node; // node for the next choice, or -1 if not visited yet
+  };
+  // node pools, cleared but not freed when a new rng starts using them
+  struct Storage {
+    std::vector<Node> nodes;
+    std::vector<Entry> entries;
   };
-  Tree root;
-  Tree* cur;
+  static const size_t DEFAULT_MEMORY_LIMIT = 16 << 20; // bytes
+
+private:
+  int budget, initial_budget;
+  size_t memory_limit = DEFAULT_MEMORY_LIMIT;
+  RNG& rng;
+  Storage own_storage;
+  Storage& storage;
+  int cur = -1;          // current node, or -1 if it doesn't exist yet
+  int parent_entry = -1; // entry that links to the current node, or -1 for the root
 public:
   LowVarianceRNG(RNG& rng, int budget = 10000)
+    : LowVarianceRNG(rng, own_storage, budget)
+  {}
+  LowVarianceRNG(RNG& rng, Storage& storage, int budget = 10000)
     : budget(budget), initial_budget(budget)
     , rng(rng)
-    , cur(&root)
-  {}
+    , storage(storage)
+  {
+    storage.nodes.clear();
+    storage.entries.clear();
+  }
+  // a copy would share the pools of the original (and dangle if they are its own)
+  LowVarianceRNG(LowVarianceRNG const&) = delete;
+  LowVarianceRNG& operator = (LowVarianceRNG const&) = delete;
 
   // Start a new run
   void start() {
-    cur = &root;
+    cur = storage.nodes.empty() ? -1 : 0;
+    parent_entry = -1;
     budget = initial_budget;
   }
 
+  void set_memory_limit(size_t bytes) {
+    memory_limit = bytes;
+  }
+  size_t num_nodes() const {
+    return storage.nodes.size();
+  }
+  size_t memory_used() const {
+    return storage.nodes.size() * sizeof(Node) + storage.entries.size() * sizeof(Entry);
+  }
+
   int random(int n);
 
   template <typename Key>
@@ -161,34 +235,42 @@ public:
 // Random number generator that uses permutations to reduce variance (as above)
 // but to detect 'the same' call to .random(), we use a caller provided key
 //
-// So for each (key,n) we keep a sperate permutation.
-// 
+// So for each (key,n) we keep a sperate permutation for every time that it is used in a run.
+//
+// The (key,n) pairs are stored in a flat open addressing hash table,
+// and the permutations are allocated from a single arena, which is kept across runs.
+// A key that is used more than MAX_PERMUTATIONS times in one run falls back to plain random numbers.
 template <typename Key>
 class KeyedRNG {
 private:
-  struct Header {
-    Key key;
-    int n;
-    inline bool operator == (Header const& that) const noexcept {
-      return key == that.key && n == that.n;
-    }
-  };
-  struct Entry {
-    int i; // number of items from the permutation used
-    std::vector<int> perm; // permutation of [0..n-1]
-  };
-  struct KeyEntry {
-    size_t times_used = 0; // number of times this key has been used in this run
-    std::vector<Entry> entries;
-  };
-  struct HeaderHash {
-    inline size_t operator()(Header const&) const noexcept;
+  struct Slot {
+    Key key = {};
+    int n = 0;        // range, 0 for empty slots
+    int count = 0;    // number of permutations for this key
+    int first = -1;   // arena index of the permutation for the first use in a run
+    int last = -1;    // arena index of the most recently allocated permutation
+    int cur = -1;     // arena index of the permutation for the next use in the current run
+    unsigned run = 0; // run in which cur was last updated
   };
-  std::unordered_map<Header,KeyEntry,HeaderHash> table;
+  // A permutation in the arena is stored as [i, next, perm[0..n-1]], where
+  //  i = number of items from the permutation used
+  //  next = arena index of the permutation for the next use of the same key, or -1
+  static const int PERM_HEADER = 2;
+  static const int MAX_PERMUTATIONS = 32;
+  std::vector<Slot> slots; // size is a power of 2, at most half full
+  int num_used_slots = 0;
+  std::vector<int> arena;
+  unsigned run = 0;
   RNG& rng;
+
+  Slot& find(Key key, int n);
+  void grow();
 public:
-  KeyedRNG(RNG& rng) : rng(rng) {}
-  void start();
+  KeyedRNG(RNG& rng) : slots(64), rng(rng) {}
+  // Start a new run, this doesn't touch the table: slots are reset when they are first used in the run
+  void start() {
+    run++;
+  }
   int random(int n, Key key);
 };
 
@@ -214,17 +296,41 @@ struct RNGKey{ int key; };
 // The RNG to use in battles
 // -----------------------------------------------------------------------------
 
-#define LOW_VARIANCE_RNG 0
-#define KEYED_RNG 1
-
-#if LOW_VARIANCE_RNG
-  using BattleRNG = FastLowVarianceRNG;
-  extern BattleRNG global_battle_rng;
-#elif KEYED_RNG
-  using BattleRNG = KeyedRNG<RNGKey>;
-  extern BattleRNG global_battle_rng;
-#else
-  using BattleRNG = RNG&;
-  #define global_battle_rng global_rng
-#endif
+// Battles are templates on the rng policy, so there is no dispatch in the battle loop.
+// The policy is picked at runtime for each simulation (see battle_rng_policy).
+enum class RNGPolicy : unsigned char {
+  Plain,       // RNG
+  LowVariance, // FastLowVarianceRNG
+  Keyed,       // KeyedRNG<RNGKey>
+  LowVarianceTree, // LowVarianceRNG
+};
+const int NUM_RNG_POLICIES = 4;
+
+inline const char* name(RNGPolicy policy) {
+  switch (policy) {
+    case RNGPolicy::Plain:       return "plain";
+    case RNGPolicy::LowVariance: return "lowvariance";
+    case RNGPolicy::Keyed:       return "keyed";
+    case RNGPolicy::LowVarianceTree: return "lowvariancetree";
+    default: return "";
+  }
+}
+
+// The battle code is explicitly instantiated for these rng types
+#define FOR_EACH_RNG(X) X(RNG) X(FastLowVarianceRNG) X(KeyedRNG<RNGKey>) X(LowVarianceRNG)
+
+// policy used for simulations
+extern RNGPolicy battle_rng_policy;
+
+// The default rng for battles, and a global instance of each policy for battles outside of simulations
+using BattleRNG = KeyedRNG<RNGKey>;
+extern BattleRNG global_battle_rng;
+extern FastLowVarianceRNG global_low_variance_rng;
+extern LowVarianceRNG global_low_variance_tree_rng;
+
+template <typename R> R& global_rng_for();
+template <> inline RNG& global_rng_for<RNG>() { return global_rng; }
+template <> inline FastLowVarianceRNG& global_rng_for<FastLowVarianceRNG>() { return global_low_variance_rng; }
+template <> inline KeyedRNG<RNGKey>& global_rng_for<KeyedRNG<RNGKey>>() { return global_battle_rng; }
+template <> inline LowVarianceRNG& global_rng_for<LowVarianceRNG>() { return global_low_variance_tree_rng; }
 
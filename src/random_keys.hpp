@@ -36,8 +36,8 @@ inline RNGKey rng_key(RNGType type, int player, Minion const& attacker) {
 template <typename A, int N>
 constexpr int array_size(A(&)[N]) { return N; }
 
-template <typename A, int N, typename Key>
-A random_element(A(& list)[N], BattleRNG& rng, Key key) {
+template <typename A, int N, typename R, typename Key>
+A random_element(A(& list)[N], R& rng, Key key) {
   return list[rng.random(array_size(list), key)];
 }
 
@@ -24,12 +24,14 @@ struct REPL {
   vector<int> actual_outcomes;
 
   // single stepping
-  unique_ptr<Battle> active_battle;
-  vector<unique_ptr<Battle>> history;
+  unique_ptr<VerboseBattle> active_battle;
+  vector<unique_ptr<VerboseBattle>> history;
 
   // simulating
   int default_num_runs = DEFAULT_NUM_RUNS;
   Objective optimization_objective = Objective::DamageTaken;
+  FirstPlayerSampling first_player_sampling = FirstPlayerSampling::Random;
+  ScoreSummary last_results; // of the last simulation or merge
 
   // error messages
   ErrorHandler error;
@@ -61,11 +63,16 @@ struct REPL {
   void do_reset();
   void do_step();
   void do_trace();
+  void do_events();
   void do_back();
   void do_list_minions();
   void do_list_hero_powers();
   void do_list_objectives();
   void do_run(int runs = -1);
+  void do_run_until(double target, int max_runs);
+  void print_results(ScoreSummary const& stats);
+  void do_summary();
+  void do_merge(std::string const& filename);
   void do_optimize_order(Objective objective, int runs = -1);
   void do_optimize_buff_placement(Minion const& buff, Objective objective, int runs = -1);
   void do_add_minion(Minion const&);
@@ -156,9 +163,44 @@ void REPL::parse_line(StringParser& in) {
     }
   } else if (in.match("run") || in.match("simulate")) {
     in.match(":"); // optional
-    int n = -1;
-    in.match_int(n); // optional
-    do_run(n);
+    if (in.match("until")) {
+      // run until ±<x>[%] [max <n>]
+      in.skip_ws();
+      if (!in.match_exact("±")) in.match_exact("+-"); // optional
+      double target = 0;
+      int max_runs = max(MIN_ADAPTIVE_RUNS, 100 * default_num_runs);
+      if (!in.parse_positive(target)) return;
+      if (in.match_exact("%")) {
+        if (!is_rate(optimization_objective)) {
+          error() << "A percentage can only be used with the win rate or death rate objective" << endl;
+          return;
+        }
+        target /= 100;
+      }
+      if (in.match("max") && !in.parse_positive(max_runs)) return;
+      if (max_runs < MIN_ADAPTIVE_RUNS) {
+        error() << "Maximum number of runs must be at least " << MIN_ADAPTIVE_RUNS << endl;
+        return;
+      }
+      if (in.parse_end()) {
+        do_run_until(target, max_runs);
+      }
+    } else {
+      int n = -1;
+      in.match_int(n); // optional
+      do_run(n);
+    }
+  } else if (in.match("summary")) {
+    in.parse_end();
+    do_summary();
+  } else if (in.match("merge")) {
+    in.match(":"); // optional
+    in.skip_ws();
+    std::string filename;
+    if (in.parse_string(filename)) {
+      while (!filename.empty() && isspace((unsigned char)filename.back())) filename.pop_back();
+      do_merge(filename);
+    }
   } else if (in.match("objective")) {
     in.match(":"); // optional
     Objective obj;
@@ -184,6 +226,36 @@ void REPL::parse_line(StringParser& in) {
     if (in.parse_positive(n) && in.parse_end()) {
       default_num_runs = n;
     }
+  } else if (in.match("seed")) {
+    in.match(":"); // optional
+    int n = 0;
+    if (in.parse_non_negative(n) && in.parse_end()) {
+      global_rng = RNG::stream(n, 0);
+    }
+  } else if (in.match("rng")) {
+    in.match(":"); // optional
+    RNGPolicy policy;
+    in.skip_ws();
+    if (in.end()) {
+      out << "rng: " << name(battle_rng_policy) << endl;
+    } else if (parse_rng_policy(in, policy) && in.parse_end()) {
+      battle_rng_policy = policy;
+    }
+  } else if (in.match("firstplayer")) {
+    in.match(":"); // optional
+    FirstPlayerSampling sampling;
+    in.skip_ws();
+    if (in.end()) {
+      out << "firstplayer: " << name(first_player_sampling) << endl;
+    } else if (parse_first_player_sampling(in, sampling) && in.parse_end()) {
+      first_player_sampling = sampling;
+    }
+  } else if (in.match("threads")) {
+    in.match(":"); // optional
+    int n = 1;
+    if (in.parse_positive(n) && in.parse_end()) {
+      global_thread_pool.resize(n);
+    }
   } else if (in.match("level")) {
     in.match(":"); // optional
     int n = 0;
@@ -226,6 +298,9 @@ void REPL::parse_line(StringParser& in) {
   } else if (in.match("back")) {
     in.parse_end();
     do_back();
+  } else if (in.match("events")) {
+    in.parse_end();
+    do_events();
   } else {
     in.unknown("command");
   }
@@ -260,8 +335,16 @@ void REPL::do_help() {
   out << "-- Running simulations" << endl;
   out << "actual <i> = tell about actual outcome (used in simulation display)" << endl;
   out << "run [<n>]  = run n simulations (default: 100)" << endl;
+  out << "run until ±<x> [max <n>] = run until the 95% confidence interval of the objective is at most ±x, e.g. ±0.5 damage or ±1% win rate" << endl;
+  out << "             (runs are done in chunks of " << SIMULATION_CHUNK_SIZE << ", so max is rounded up to a multiple of that)" << endl;
+  out << "summary    = show the results of the last simulation as a single line, for merging" << endl;
+  out << "merge <file> = combine the summary lines in a file, e.g. of simulations in separate processes" << endl;
   out << "optimize   = optimize the minion order to maximize some objective" << endl;
   out << "objective  = set the optimization objective (default: minimize damage taken)" << endl;
+  out << "threads <n> = number of threads to use for simulations (default: all cores)" << endl;
+  out << "seed <n>   = set the random seed, to make the following simulations reproducible" << endl;
+  out << "rng <rng>  = random number generator for simulations: keyed (default), lowvariance, lowvariancetree or plain" << endl;
+  out << "firstplayer <x> = who attacks first with equal board sizes: random (default) or stratified (exactly half the runs each)" << endl;
   out << endl;
   out << "-- Stepping through a single battle" << endl;
   out << "show       = show the board state" << endl;
@@ -269,6 +352,7 @@ void REPL::do_help() {
   out << "step       = do 1 attack step, or start if battle not started yet" << endl;
   out << "trace      = do steps until the battle ends" << endl;
   out << "back       = step backward. can be used to re-roll RNG" << endl;
+  out << "events     = run a new battle and list its events, one per line" << endl;
   out << endl;
   out << "-- Other" << endl;
   out << "info       = show a message" << endl;
@@ -351,24 +435,23 @@ void REPL::do_buff_minion(MinionAndSideRef const& ref, Minion const& buff) {
   active_battle.reset();
 }
 
-void print_stats(ostream& out, ScoreSummary const& stats, vector<int> const& results) {
+void print_stats(ostream& out, ScoreSummary const& stats) {
   out << "win: " << percentage(stats.win_rate(0)) << ", ";
   out << "tie: " << percentage(stats.draw_rate()) << ", ";
   out << "lose: " << percentage(stats.win_rate(1)) << endl;
   out.precision(3);
   out << "mean score: " << stats.mean_score();
-  out << ", median score: " << results[results.size()/2] << endl;
+  out << ", median score: " << stats.scores.quantile(0.5) << endl;
   int steps = 10;
-  int n = (int)results.size() - 1;
   out << "percentiles: ";
   for (int i=0; i <= steps; ++i) {
-    out << results[i*(n-1)/steps] << " ";
+    out << stats.scores.quantile((double)i/steps) << " ";
   }
   out << endl;
 }
 
-void print_outcome_percentile(ostream& out, int outcome, vector<int> const& results) {
-  int p = percentile(outcome,results);
+void print_outcome_percentile(ostream& out, int outcome, ScoreSummary const& stats) {
+  int p = percentile(outcome,stats.scores);
   out << "actual outcome: " << outcome << ", is at the " << p << "-th percentile"
       << (p < 15 ? ", you got unlucky" : p > 85 ? ", you got lucky" : "") << endl;
 }
@@ -383,17 +466,77 @@ void print_damage_taken(ostream& out, ScoreSummary const& stats, int health, int
   }
 }
 
-void REPL::do_run(int n) {
-  if (n <= 0) n = default_num_runs;
-  vector<int> results;
-  ScoreSummary stats = simulate(players[0], players[1], n, &results);
+void REPL::print_results(ScoreSummary const& stats) {
+  last_results = stats;
   out << "--------------------------------" << endl;
-  print_stats(out, stats, results);
+  print_stats(out, stats);
   for (int o : actual_outcomes) {
-    print_outcome_percentile(out, o, results);
+    print_outcome_percentile(out, o, stats);
   }
   print_damage_taken(out, stats, players[0].health, 0);
   print_damage_taken(out, stats, players[1].health, 1);
+}
+
+void REPL::do_run(int n) {
+  if (n <= 0) n = default_num_runs;
+  if (first_player_sampling == FirstPlayerSampling::Stratified) {
+    StratifiedSummary strata = simulate_stratified(players[0], players[1], n);
+    print_results(strata.combined());
+    for (int player=0; player<2; ++player) {
+      ScoreSummary const& stats = strata.by_first_player[player];
+      if (stats.num_runs == 0) continue;
+      out << "when " << (player == 0 ? "you" : "they") << " attack first (" << stats.num_runs << " runs): ";
+      out << "win: " << percentage(stats.win_rate(0)) << ", ";
+      out << "tie: " << percentage(stats.draw_rate()) << ", ";
+      out << "lose: " << percentage(stats.win_rate(1)) << endl;
+    }
+  } else {
+    ScoreSummary stats = simulate(players[0], players[1], n);
+    print_results(stats);
+  }
+  out << "--------------------------------" << endl;
+  used = true;
+}
+
+void REPL::do_summary() {
+  write_summary(out, last_results);
+}
+
+void REPL::do_merge(std::string const& filename) {
+  ifstream file(filename);
+  if (!file) {
+    error() << "Can't open file " << filename << endl;
+    return;
+  }
+  ScoreSummary total;
+  int line_number = 0;
+  while (file.peek() != EOF) {
+    line_number++;
+    ScoreSummary stats;
+    if (!read_summary(file, stats)) {
+      error() << filename << ":" << line_number << ": Expected a summary line" << endl;
+      return;
+    }
+    total += stats;
+  }
+  print_results(total);
+  out << "--------------------------------" << endl;
+  used = true;
+}
+
+void REPL::do_run_until(double target, int max_runs) {
+  Objective objective = optimization_objective;
+  AdaptiveSimulation sim = simulate_until(players[0], players[1], objective, target, max_runs);
+  print_results(sim.stats);
+  out << name(objective) << ": ";
+  display_objective_value(out, objective, objective_value(objective, sim.stats));
+  out << " ± ";
+  display_objective_difference(out, objective, sim.half_width);
+  out << ", using " << sim.stats.num_runs << " runs";
+  if (!sim.converged) {
+    out << " (maximum number of runs reached)";
+  }
+  out << endl;
   out << "--------------------------------" << endl;
   used = true;
 }
@@ -409,17 +552,26 @@ void REPL::do_optimize_order(Objective objective, int n) {
     out << " to ";
     display_objective_value(out, objective, opt.best_score);
     out << " by reordering your minions:" << endl;
+    out << "(compared " << opt.num_orders << " orders";
+    if (opt.num_pruned) {
+      out << ", skipped " << opt.num_pruned << " that only swap identical minions";
+    }
+    out << ", using " << opt.total_runs << " runs)" << endl;
     Board new_board = players[0];
     permute_minions(new_board, &players[0].minions[0], opt.best_order.data(), opt.n);
     out << new_board;
-    // TODO: significance test?
+    out << "Improvement: ";
+    display_improvement(out, objective, opt.improvement);
+    out << endl;
+    if (opt.improvement.p_value() >= 0.05) {
+      out << "This improvement is not statistically significant, the orders might be equally good" << endl;
+    }
   }
   used = true;
 }
 
 void REPL::do_optimize_buff_placement(Minion const& buff, Objective objective, int n) {
   if (n <= 0) n = default_num_runs;
-  // TODO
   OptimizeMinionBuffPlacement opt(players[0], players[1], buff, objective, n);
   out << "Current " << name(objective) << " is ";
   display_objective_value(out, objective, opt.current_score);
@@ -432,12 +584,17 @@ void REPL::do_optimize_buff_placement(Minion const& buff, Objective objective, i
     }
     out << endl;
   });
+  if (opt.best_vs_next.runs > 0) {
+    out << "Compared to the next best placement: ";
+    display_improvement(out, objective, opt.best_vs_next);
+    out << endl;
+  }
+  used = true;
 }
 
 void REPL::do_show() {
   if (!active_battle) {
-    active_battle.reset(new Battle(players[0], players[1], &out));
-    active_battle->verbose = 2;
+    active_battle.reset(new VerboseBattle(players[0], players[1], TextTrace(&out, 2)));
   }
   out << *active_battle;
 }
@@ -451,13 +608,12 @@ void REPL::do_reset() {
 void REPL::do_step() {
   if (!active_battle) {
     history.clear();
-    active_battle.reset(new Battle(players[0], players[1], &out));
-    active_battle->verbose = 2;
+    active_battle.reset(new VerboseBattle(players[0], players[1], TextTrace(&out, 2)));
   } else if (!active_battle->started()) {
-    history.push_back(unique_ptr<Battle>(new Battle(*active_battle)));
+    history.push_back(unique_ptr<VerboseBattle>(new VerboseBattle(*active_battle)));
     active_battle->start();
   } else if (!active_battle->done()) {
-    history.push_back(unique_ptr<Battle>(new Battle(*active_battle)));
+    history.push_back(unique_ptr<VerboseBattle>(new VerboseBattle(*active_battle)));
     active_battle->attack_round();
   } else {
     out << "Battle is done, score: " << active_battle->score() << endl;
@@ -472,6 +628,15 @@ void REPL::do_trace() {
   do_step();
 }
 
+void REPL::do_events() {
+  BasicBattle<EventTrace,BattleRNG> battle(players[0], players[1]);
+  battle.run();
+  for (auto const& event : battle.trace.events) {
+    out << event << endl;
+  }
+  out << "score: " << battle.score() << endl;
+}
+
 void REPL::do_back() {
   if (!history.empty()) {
     active_battle = move(history.back());
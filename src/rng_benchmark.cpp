@@ -0,0 +1,148 @@
+#include "random.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// -----------------------------------------------------------------------------
+// Reference: the previous bounded random numbers
+// -----------------------------------------------------------------------------
+
+// one 64 bit output per call, reduced with a modulo (slightly biased)
+struct ModuloRNG {
+  RNG rng;
+  ModuloRNG(RNG const& rng) : rng(rng) {}
+  inline int random(int range) {
+    return (int)(rng.next() % (uint64_t)range);
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Speed
+// -----------------------------------------------------------------------------
+
+template <typename R>
+void time_random(const char* name, R rng) {
+  using namespace std::chrono;
+  const int calls = 50000000;
+  int64_t checksum = 0;
+  auto start = high_resolution_clock::now();
+  for (int i=0; i<calls; ++i) {
+    // ranges as used in battles: small and varying
+    checksum += rng.random(2 + (i & 7));
+  }
+  auto end = high_resolution_clock::now();
+  duration<double> t = end-start;
+  cout << setw(16) << left << name << right << " ns/call: " << setprecision(4) << (t.count() * 1e9 / calls);
+  cout << "    (checksum " << checksum << ")" << endl;
+}
+
+void time_shuffle() {
+  using namespace std::chrono;
+  const int calls = 5000000;
+  RNG rng = RNG::stream(0, 0);
+  int data[7] = {0,1,2,3,4,5,6};
+  int64_t checksum = 0;
+  auto start = high_resolution_clock::now();
+  for (int i=0; i<calls; ++i) {
+    rng.shuffle(data, 7);
+    checksum += data[0];
+  }
+  auto end = high_resolution_clock::now();
+  duration<double> t = end-start;
+  cout << setw(16) << left << "shuffle(7)" << right << " ns/call: " << setprecision(4) << (t.count() * 1e9 / calls);
+  cout << "    (checksum " << checksum << ")" << endl;
+}
+
+// Low variance rngs, with runs of a fixed number of small choices like in a battle
+template <typename R>
+double time_low_variance(R& rng) {
+  using namespace std::chrono;
+  const int runs = 200000, calls = 12;
+  int64_t checksum = 0;
+  auto start = high_resolution_clock::now();
+  for (int i=0; i<runs; ++i) {
+    rng.start();
+    for (int j=0; j<calls; ++j) {
+      checksum += rng.random(2 + j % 6);
+    }
+  }
+  auto end = high_resolution_clock::now();
+  duration<double> t = end-start;
+  if (checksum < 0) cout << checksum; // keep the calls
+  return t.count() * 1e9 / (runs * calls);
+}
+
+void time_low_variance() {
+  RNG stream = RNG::stream(0, 0);
+  FastLowVarianceRNG fast(stream);
+  cout << setw(16) << left << "lowvariance" << right << " ns/call: " << setprecision(4) << time_low_variance(fast) << endl;
+  for (int budget : {10000, 100000000}) {
+    LowVarianceRNG tree(stream, budget);
+    tree.set_memory_limit(64 << 20);
+    double ns = time_low_variance(tree);
+    cout << setw(16) << left << "lowvariancetree" << right << " ns/call: " << setprecision(4) << ns;
+    cout << "    budget: " << budget << ", nodes: " << tree.num_nodes() << ", memory: " << (tree.memory_used() >> 10) << " KB" << endl;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Statistical tests
+// -----------------------------------------------------------------------------
+
+// p-value of a chi-square statistic with k degrees of freedom (Wilson-Hilferty approximation)
+double chi_square_p_value(double chi2, int k) {
+  double z = (pow(chi2 / k, 1.0/3) - (1 - 2.0/(9*k))) / sqrt(2.0/(9*k));
+  return 0.5 * erfc(z / sqrt(2.0));
+}
+
+double chi_square(vector<int64_t> const& counts, double expected) {
+  double chi2 = 0;
+  for (auto c : counts) {
+    chi2 += (c - expected) * (c - expected) / expected;
+  }
+  return chi2;
+}
+
+// Are random(range) uniform, and are consecutive pairs independent?
+// Returns false if the result is suspicious (p < 0.0001 on either side)
+template <typename R>
+bool test_uniform(const char* name, R rng, int range) {
+  const int n = 10000000;
+  vector<int64_t> counts(range), pair_counts(range * range);
+  int prev = 0;
+  for (int i=0; i<n; ++i) {
+    int x = rng.random(range);
+    counts[x]++;
+    if (i & 1) pair_counts[prev * range + x]++;
+    prev = x;
+  }
+  double p = chi_square_p_value(chi_square(counts, (double)n / range), range - 1);
+  double p_pairs = chi_square_p_value(chi_square(pair_counts, (double)n / 2 / (range * range)), range * range - 1);
+  bool ok = p > 1e-4 && p < 1-1e-4 && p_pairs > 1e-4 && p_pairs < 1-1e-4;
+  cout << setw(16) << left << name << right << " range " << setw(3) << range;
+  cout << "    p: " << setprecision(4) << setw(8) << p << "    p pairs: " << setw(8) << p_pairs;
+  cout << (ok ? "" : "    SUSPICIOUS") << endl;
+  return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Main function
+// -----------------------------------------------------------------------------
+
+int main(int argc, char const** argv) {
+  for (int rep=0; rep<3; ++rep) {
+    time_random("modulo", ModuloRNG(RNG::stream(0, 0)));
+    time_random("random", RNG::stream(0, 0));
+    time_shuffle();
+    time_low_variance();
+  }
+  bool ok = true;
+  for (int range : {2, 3, 5, 6, 7, 8, 13, 24}) {
+    test_uniform("modulo", ModuloRNG(RNG::stream(1, range)), range);
+    ok = test_uniform("random", RNG::stream(1, range), range) && ok;
+  }
+  return ok ? 0 : 1;
+}
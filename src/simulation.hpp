@@ -1,9 +1,15 @@
 #pragma once
 
 #include "battle.hpp"
+#include "vanilla_battle.hpp"
+#include "thread_pool.hpp"
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
 using std::vector;
 
 // -----------------------------------------------------------------------------
@@ -12,14 +18,70 @@ using std::vector;
 
 const int DEFAULT_NUM_RUNS = 1000;
 
+// Runs are simulated in chunks of this many battles.
+// Chunk c of a simulation with a given seed always uses the random stream RNG::stream(seed,c),
+// and the chunk results are merged in order.
+// So the outcome of run i doesn't depend on the number of threads used, or on how the runs are sharded.
+const int SIMULATION_CHUNK_SIZE = 128;
+
+// -----------------------------------------------------------------------------
+// Simulation results
+// -----------------------------------------------------------------------------
+
 enum class Flipped { Flipped };
 
+// Scores are total stars of the remaining minions, so they are in [-MAX_SCORE, MAX_SCORE]
+const int MAX_SCORE = BOARDSIZE * 6;
+
+// Number of runs with each score
+struct ScoreHistogram {
+  int64_t counts[2*MAX_SCORE+1] = {0};
+
+  void add(int score) {
+    counts[std::min(MAX_SCORE, std::max(-MAX_SCORE, score)) + MAX_SCORE]++;
+  }
+  int64_t count(int score) const {
+    return score < -MAX_SCORE || score > MAX_SCORE ? 0 : counts[score + MAX_SCORE];
+  }
+  int64_t total() const {
+    int64_t n = 0;
+    for (int64_t c : counts) n += c;
+    return n;
+  }
+  // the score at position i in the sorted list of all scores
+  int nth(int64_t i) const {
+    for (int s = -MAX_SCORE; s < MAX_SCORE; ++s) {
+      i -= count(s);
+      if (i < 0) return s;
+    }
+    return MAX_SCORE;
+  }
+  // the score at fraction p of the way through the sorted scores
+  int quantile(double p) const {
+    int64_t n = total();
+    return nth(n > 0 ? (int64_t)(p * (n - 1)) : 0);
+  }
+  ScoreHistogram flipped() const {
+    ScoreHistogram out;
+    for (int s = -MAX_SCORE; s <= MAX_SCORE; ++s) {
+      out.counts[s + MAX_SCORE] = count(-s);
+    }
+    return out;
+  }
+  ScoreHistogram& operator += (ScoreHistogram const& that) {
+    for (int i=0; i<2*MAX_SCORE+1; ++i) counts[i] += that.counts[i];
+    return *this;
+  }
+};
+
+// Counters are 64 bit, so summaries of billions of runs can be combined
 struct ScoreSummary {
-  int num_runs = 0;
-  int total_stars[2] = {0}; // #stars by which player i has won
-  int damage_taken[2] = {0};
-  int num_wins[2] = {0};
-  int num_deaths[2] = {0};
+  int64_t num_runs = 0;
+  int64_t total_stars[2] = {0}; // #stars by which player i has won
+  int64_t damage_taken[2] = {0};
+  int64_t num_wins[2] = {0};
+  int64_t num_deaths[2] = {0};
+  ScoreHistogram scores;
 
   ScoreSummary() {}
   ScoreSummary(ScoreSummary const& stats, Flipped flipped)
@@ -28,13 +90,28 @@ struct ScoreSummary {
     , damage_taken{stats.damage_taken[1],stats.damage_taken[0]}
     , num_wins{stats.num_wins[1],stats.num_wins[0]}
     , num_deaths{stats.num_deaths[1],stats.num_deaths[0]}
+    , scores(stats.scores.flipped())
   {}
 
   ScoreSummary flipped() const {
     return ScoreSummary(*this,Flipped::Flipped);
   }
 
-  int num_draws() const {
+  // combine results of two sets of runs.
+  // This is associative and commutative, so partial results from threads, shards or checkpoints can be merged in any grouping
+  ScoreSummary& operator += (ScoreSummary const& that) {
+    num_runs += that.num_runs;
+    for (int i=0; i<2; ++i) {
+      total_stars[i]  += that.total_stars[i];
+      damage_taken[i] += that.damage_taken[i];
+      num_wins[i]     += that.num_wins[i];
+      num_deaths[i]   += that.num_deaths[i];
+    }
+    scores += that.scores;
+    return *this;
+  }
+
+  int64_t num_draws() const {
     return num_runs - num_wins[0] - num_wins[1];
   }
   double draw_rate() const {
@@ -59,9 +136,11 @@ struct ScoreSummary {
     return mean_damage_taken(1) / 7.0 - mean_damage_taken(0);
   }
 
-  void add_run(Battle const& b) {
+  template <typename B>
+  void add_run(B const& b) {
     num_runs++;
     int stars[2] = {b.board[0].total_stars(), b.board[1].total_stars()};
+    scores.add(stars[0] > 0 && stars[1] > 0 ? 0 : stars[0] - stars[1]);
     if ((stars[0] > 0) != (stars[1] > 0)) {
       // only one player has minions remaining (and therefore stars)
       int winner = stars[0] > 0 ? 0 : 1;
@@ -78,28 +157,244 @@ struct ScoreSummary {
   }
 };
 
-inline int simulate_single(Board const& player0, Board const& player1, ScoreSummary& stats, BattleRNG& rng) {
-  Battle battle(player0, player1, nullptr, rng);
+// Results split by the player that attacked first
+struct StratifiedSummary {
+  ScoreSummary by_first_player[2];
+
+  ScoreSummary combined() const {
+    ScoreSummary out = by_first_player[0];
+    out += by_first_player[1];
+    return out;
+  }
+  StratifiedSummary& operator += (StratifiedSummary const& that) {
+    by_first_player[0] += that.by_first_player[0];
+    by_first_player[1] += that.by_first_player[1];
+    return *this;
+  }
+};
+
+// Serialization of a summary as a single line of text, for combining results of separate processes.
+// Format: "summary <runs> <stars0> <stars1> <damage0> <damage1> <wins0> <wins1> <deaths0> <deaths1>",
+// followed by "<score>:<count>" for each score that occurred.
+void write_summary(ostream& out, ScoreSummary const& stats) {
+  out << "summary " << stats.num_runs;
+  for (int i=0; i<2; ++i) out << " " << stats.total_stars[i];
+  for (int i=0; i<2; ++i) out << " " << stats.damage_taken[i];
+  for (int i=0; i<2; ++i) out << " " << stats.num_wins[i];
+  for (int i=0; i<2; ++i) out << " " << stats.num_deaths[i];
+  for (int s = -MAX_SCORE; s <= MAX_SCORE; ++s) {
+    if (stats.scores.count(s)) out << " " << s << ":" << stats.scores.count(s);
+  }
+  out << "\n";
+}
+
+// Read a summary written by write_summary, returns false if the line is malformed or inconsistent,
+// so that merging it can't corrupt a total
+bool read_summary(std::istream& in, ScoreSummary& stats) {
+  std::string line, tag;
+  if (!std::getline(in, line)) return false;
+  std::istringstream words(line);
+  stats = ScoreSummary();
+  if (!(words >> tag) || tag != "summary") return false;
+  if (!(words >> stats.num_runs) || stats.num_runs < 0) return false;
+  for (int i=0; i<2; ++i) if (!(words >> stats.total_stars[i]) || stats.total_stars[i] < 0) return false;
+  for (int i=0; i<2; ++i) if (!(words >> stats.damage_taken[i]) || stats.damage_taken[i] < 0) return false;
+  for (int i=0; i<2; ++i) if (!(words >> stats.num_wins[i]) || stats.num_wins[i] < 0) return false;
+  for (int i=0; i<2; ++i) if (!(words >> stats.num_deaths[i]) || stats.num_deaths[i] < 0) return false;
+  int score;
+  char colon;
+  int64_t count;
+  while (words >> score >> colon >> count) {
+    if (colon != ':' || score < -MAX_SCORE || score > MAX_SCORE || count < 0) return false;
+    stats.scores.counts[score + MAX_SCORE] += count;
+  }
+  if (!words.eof()) return false;
+  return stats.scores.total() == stats.num_runs && stats.num_wins[0] + stats.num_wins[1] <= stats.num_runs;
+}
+
+// Check the vanilla battle kernel against the general one
+#ifndef CHECK_VANILLA
+#define CHECK_VANILLA 0
+#endif
+
+// How to pick the player that attacks first when both boards have the same number of minions
+enum class FirstPlayerSampling : unsigned char {
+  Random,     // independently for each run
+  Stratified, // alternate between runs, so exactly half of the runs have each player attacking first
+};
+const int NUM_FIRST_PLAYER_SAMPLINGS = 2;
+
+inline const char* name(FirstPlayerSampling sampling) {
+  switch (sampling) {
+    case FirstPlayerSampling::Random:     return "random";
+    case FirstPlayerSampling::Stratified: return "stratified";
+    default: return "";
+  }
+}
+
+// B is the type of battle to run: BasicBattle or VanillaBattle
+template <typename B, typename R>
+inline int simulate_single(Battle const& prepared, StratifiedSummary& stats, R& rng, int first_player) {
+  B battle(prepared, rng);
+  battle.start(first_player);
+  int first = battle.turn;
   battle.run();
-  stats.add_run(battle);
+  stats.by_first_player[first].add_run(battle);
   return battle.score();
 }
 
-ScoreSummary simulate(Board const& player0, Board const& player1, int n = DEFAULT_NUM_RUNS, vector<int>* out = nullptr, RNG& rng = global_rng) {
-  ScoreSummary stats;
-  BattleRNG the_rng(rng);
-  if (out) out->reserve(out->size() + n);
-  for (int i=0; i<n; ++i) {
+// Simulate runs [first,end) of a single chunk, using a battle rng private to this chunk.
+// The earlier runs of the chunk are still simulated, because they affect the state of the battle rng.
+// Chunks start at an even run, so stratified runs alternate in the same way regardless of chunking.
+template <typename B, typename R>
+StratifiedSummary simulate_chunk_with(Battle const& prepared, FirstPlayerSampling sampling, int first, int end, vector<int>* out, R& the_rng) {
+  StratifiedSummary stats, skipped;
+  if (out) out->reserve(end - first);
+  for (int i=0; i<end; ++i) {
     the_rng.start();
-    int score = simulate_single(player0, player1, stats, the_rng);
-    if (out) out->push_back(score);
+    int first_player = sampling == FirstPlayerSampling::Stratified ? i % 2 : -1;
+    int score = simulate_single<B>(prepared, i < first ? skipped : stats, the_rng, first_player);
+    if (out && i >= first) out->push_back(score);
   }
-  if (out) std::sort(out->begin(), out->end());
   return stats;
 }
-ScoreSummary simulate_deterministic(Board const& player0, Board const& player1, RNG const& rng, int n = DEFAULT_NUM_RUNS, vector<int>* out = nullptr) {
+
+template <typename R>
+StratifiedSummary simulate_chunk_with(Battle const& prepared, bool vanilla, FirstPlayerSampling sampling, int first, int end, vector<int>* out, R& the_rng) {
+  if (vanilla) {
+    return simulate_chunk_with<VanillaBattle<R>>(prepared, sampling, first, end, out, the_rng);
+  } else {
+    return simulate_chunk_with<BasicBattle<SilentTrace,R>>(prepared, sampling, first, end, out, the_rng);
+  }
+}
+
+// The rng policy and battle kernel are picked once per chunk, the battles themselves are specialized to them
+StratifiedSummary simulate_chunk_unchecked(Battle const& prepared, bool vanilla, FirstPlayerSampling sampling, int first, int end, vector<int>* out, RNG rng) {
+  switch (battle_rng_policy) {
+    case RNGPolicy::Plain:
+      return simulate_chunk_with(prepared, vanilla, sampling, first, end, out, rng);
+    case RNGPolicy::LowVariance: {
+      FastLowVarianceRNG the_rng(rng);
+      return simulate_chunk_with(prepared, vanilla, sampling, first, end, out, the_rng);
+    }
+    case RNGPolicy::LowVarianceTree: {
+      // reuse the node pools of this thread, chunks never run nested on one thread
+      static thread_local LowVarianceRNG::Storage storage;
+      LowVarianceRNG the_rng(rng, storage);
+      return simulate_chunk_with(prepared, vanilla, sampling, first, end, out, the_rng);
+    }
+    case RNGPolicy::Keyed:
+    default: {
+      KeyedRNG<RNGKey> the_rng(rng);
+      return simulate_chunk_with(prepared, vanilla, sampling, first, end, out, the_rng);
+    }
+  }
+}
+
+// vanilla: both boards are vanilla (see is_vanilla), so the faster VanillaBattle can be used
+StratifiedSummary simulate_chunk(Battle const& prepared, bool vanilla, FirstPlayerSampling sampling, int first, int end, vector<int>* out, RNG rng) {
+  #if CHECK_VANILLA
+    if (vanilla) {
+      vector<int> fast_out, full_out;
+      StratifiedSummary stats = simulate_chunk_unchecked(prepared, true, sampling, first, end, &fast_out, rng);
+      simulate_chunk_unchecked(prepared, false, sampling, first, end, &full_out, rng);
+      if (fast_out != full_out) {
+        std::cerr << "Vanilla battle mismatch for" << endl << prepared;
+        std::abort();
+      }
+      if (out) out->insert(out->end(), fast_out.begin(), fast_out.end());
+      return stats;
+    }
+  #endif
+  return simulate_chunk_unchecked(prepared, vanilla, sampling, first, end, out, rng);
+}
+
+// A pair of boards to simulate: player 0 vs player 1
+using Matchup = std::pair<Board,Board>;
+
+// Simulate runs [first_run, first_run+n) of each matchup, matchup i uses the simulation with seed seeds[i].
+// All chunks of all matchups are scheduled together, so the work is balanced across threads,
+// and each matchup is prepared (auras computed) only once.
+// Scores of matchup i are appended to (*out)[i] in order of the runs.
+vector<StratifiedSummary> simulate_batch_range_stratified(vector<Matchup> const& matchups, vector<uint64_t> const& seeds, int first_run, int n, vector<vector<int>>* out = nullptr, FirstPlayerSampling sampling = FirstPlayerSampling::Stratified) {
+  int num_matchups = (int)matchups.size();
+  vector<StratifiedSummary> stats(num_matchups);
+  if (out && (int)out->size() < num_matchups) out->resize(num_matchups);
+  if (n <= 0) return stats;
+  vector<Battle> prepared;
+  vector<char> vanilla;
+  prepared.reserve(num_matchups);
+  for (auto const& m : matchups) {
+    prepared.emplace_back(m.first, m.second);
+    vanilla.push_back(is_vanilla(prepared.back().board[0]) && is_vanilla(prepared.back().board[1]));
+  }
+  int end_run = first_run + n;
+  int first_chunk = first_run / SIMULATION_CHUNK_SIZE;
+  int num_chunks = (end_run + SIMULATION_CHUNK_SIZE - 1) / SIMULATION_CHUNK_SIZE - first_chunk;
+  // simulate chunks in parallel
+  vector<StratifiedSummary> chunk_stats(num_matchups * num_chunks);
+  vector<vector<int>> chunk_out(out ? num_matchups * num_chunks : 0);
+  global_thread_pool.parallel_for(num_matchups * num_chunks, [&](int k) {
+    int i = k / num_chunks;
+    int chunk = first_chunk + k % num_chunks;
+    int start = chunk * SIMULATION_CHUNK_SIZE;
+    int first = max(first_run, start) - start;
+    int end = min(end_run - start, SIMULATION_CHUNK_SIZE);
+    chunk_stats[k] = simulate_chunk(prepared[i], vanilla[i], sampling, first, end, out ? &chunk_out[k] : nullptr, RNG::stream(seeds[i], chunk));
+  });
+  // merge in order
+  for (int k=0; k<num_matchups * num_chunks; ++k) {
+    int i = k / num_chunks;
+    stats[i] += chunk_stats[k];
+    if (out) {
+      (*out)[i].insert((*out)[i].end(), chunk_out[k].begin(), chunk_out[k].end());
+    }
+  }
+  return stats;
+}
+
+// As above, with the first player picked at random
+vector<ScoreSummary> simulate_batch_range(vector<Matchup> const& matchups, vector<uint64_t> const& seeds, int first_run, int n, vector<vector<int>>* out = nullptr) {
+  vector<ScoreSummary> stats;
+  for (auto const& s : simulate_batch_range_stratified(matchups, seeds, first_run, n, out, FirstPlayerSampling::Random)) {
+    stats.push_back(s.combined());
+  }
+  return stats;
+}
+
+// Simulate runs [first_run, first_run+n) of the simulation with the given seed.
+// Scores are appended to out in order of the runs.
+ScoreSummary simulate_range(Board const& player0, Board const& player1, uint64_t seed, int first_run, int n, vector<int>* out = nullptr) {
+  vector<vector<int>> outs;
+  ScoreSummary stats = simulate_batch_range({{player0,player1}}, {seed}, first_run, n, out ? &outs : nullptr)[0];
+  if (out) out->insert(out->end(), outs[0].begin(), outs[0].end());
+  return stats;
+}
+
+// Simulate n runs of each matchup, each with their own random numbers.
+// Matchup i gives the same result as simulate() would after i earlier simulations with the same rng.
+vector<ScoreSummary> simulate_batch(vector<Matchup> const& matchups, int n = DEFAULT_NUM_RUNS, RNG& rng = global_rng) {
+  vector<uint64_t> seeds;
+  for (size_t i=0; i<matchups.size(); ++i) {
+    seeds.push_back(rng.next());
+  }
+  return simulate_batch_range(matchups, seeds, 0, n);
+}
+
+ScoreSummary simulate(Board const& player0, Board const& player1, int n = DEFAULT_NUM_RUNS, RNG& rng = global_rng) {
+  uint64_t seed = rng.next();
+  return simulate_range(player0, player1, seed, 0, n);
+}
+ScoreSummary simulate_deterministic(Board const& player0, Board const& player1, RNG const& rng, int n = DEFAULT_NUM_RUNS) {
   RNG rng_copy = rng; // copy the rng for repeatability
-  return simulate(player0, player1, n, out, rng_copy);
+  return simulate(player0, player1, n, rng_copy);
+}
+
+// Simulate n runs, with exactly half of them (rounded up) having player 0 attack first when both boards have the same size.
+// This removes the variance of the first player coin flip, so the combined results are more accurate for the same number of runs.
+StratifiedSummary simulate_stratified(Board const& player0, Board const& player1, int n = DEFAULT_NUM_RUNS, RNG& rng = global_rng) {
+  uint64_t seed = rng.next();
+  return simulate_batch_range_stratified({{player0,player1}}, {seed}, 0, n)[0];
 }
 
 // -----------------------------------------------------------------------------
@@ -123,27 +418,28 @@ double variance(vector<T> const& xs) {
   return sum / std::max(1, (int)xs.size()-1);
 }
 
-double mean_damage_taken(vector<int> const& xs, int enemy_level, int sign = 1) {
+double mean_damage_taken(ScoreHistogram const& scores, int enemy_level, int sign = 1) {
   double sum = 0.;
-  for(int x : xs) if (sign*x < 0) sum += enemy_level - sign*x;
-  return sum / xs.size();
+  for (int x = -MAX_SCORE; x <= MAX_SCORE; ++x) if (sign*x < 0) sum += (double)scores.count(x) * (enemy_level - sign*x);
+  return sum / max<int64_t>(1, scores.total());
 }
 
-double mean_damage_dealt(vector<int> const& xs, int level) {
-  return mean_damage_taken(xs,level,-1);
+double mean_damage_dealt(ScoreHistogram const& scores, int level) {
+  return mean_damage_taken(scores,level,-1);
 }
 
-double death_rate(vector<int> const& results, int enemy_level, int health, int sign = 1) {
-  int deaths = 0;
-  for(int x : results) if (sign*x < 0 && (enemy_level - sign*x) >= health) deaths++;
-  return (double)deaths / results.size();
+double death_rate(ScoreHistogram const& scores, int enemy_level, int health, int sign = 1) {
+  int64_t deaths = 0;
+  for (int x = -MAX_SCORE; x <= MAX_SCORE; ++x) if (sign*x < 0 && (enemy_level - sign*x) >= health) deaths += scores.count(x);
+  return (double)deaths / max<int64_t>(1, scores.total());
 }
 
-int percentile(int i, vector<int> const& results) {
-  auto bounds = equal_range(results.begin(), results.end(), i);
-  int a = static_cast<int>(bounds.first - results.begin());
-  int b = static_cast<int>(bounds.second - results.begin());
-  return 100 * (a + b) / 2 / (results.size() - 1);
+// percentile of score i among all scores
+int percentile(int i, ScoreHistogram const& scores) {
+  int64_t a = 0; // number of scores < i
+  for (int x = -MAX_SCORE; x < i && x <= MAX_SCORE; ++x) a += scores.count(x);
+  int64_t b = a + scores.count(i); // number of scores <= i
+  return (int)(100. * (a + b) / 2 / max<int64_t>(1, scores.total() - 1));
 }
 
 // -----------------------------------------------------------------------------
@@ -168,6 +464,17 @@ double objective_value(Objective objective, ScoreSummary const& stats) {
   }
 }
 
+// objective value of a single run with the given score, consistent with the above
+double objective_value(Objective objective, int score, Board const& player0, Board const& player1) {
+  switch(objective) {
+    case Objective::Score:       return score;
+    case Objective::WinRate:     return score > 0 ? 1 : score == 0 ? 0.5 : 0;
+    case Objective::DamageTaken: return score < 0 ? -(player1.level - score) : 0;
+    case Objective::DeathRate:   return score < 0 && player1.level - score >= player0.health ? -1 : 0;
+    default: return 0;
+  }
+}
+
 const char* name(Objective objective) {
   switch(objective) {
     case Objective::Score:       return "star difference";
@@ -178,13 +485,18 @@ const char* name(Objective objective) {
   }
 }
 
+// is the objective a rate, so that it can be given as a percentage?
+bool is_rate(Objective objective) {
+  return objective == Objective::WinRate || objective == Objective::DeathRate;
+}
+
 struct Percentage {
   double p;
 };
 // output a number between 0 and 1 as a percentage
 inline Percentage percentage(double p) { return {p}; }
 inline ostream& operator << (ostream& out, Percentage p) {
-  out.setf(std::ios::fixed, std:: ios::floatfield);
+  out.setf(std::ios::fixed, std::ios::floatfield);
   out.precision(1);
   return out << (100*p.p) << "%";
 }
@@ -209,6 +521,210 @@ void display_objective_value(ostream& out, Objective objective, double score) {
   }
 }
 
+// show the size of a difference in objective values, (always positive)
+void display_objective_difference(ostream& out, Objective objective, double diff) {
+  out.setf(std::ios::fixed, std:: ios::floatfield);
+  switch(objective) {
+    case Objective::Score:
+    case Objective::DamageTaken:
+      out.precision(3);
+      out << diff;
+      return;
+    case Objective::WinRate:
+    case Objective::DeathRate:
+      out << percentage(diff);
+      return;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Adaptive simulation
+// -----------------------------------------------------------------------------
+
+// Two sided 95% quantile of Student's t distribution with the given degrees of freedom
+double t_quantile_95(int dof) {
+  static const double table[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+  };
+  if (dof < 1) return std::numeric_limits<double>::infinity();
+  if (dof <= 30) return table[dof-1];
+  return 1.96;
+}
+
+// Minimum number of chunks before we trust the confidence interval
+const int MIN_ADAPTIVE_CHUNKS = 4;
+// Minimum number of runs for simulate_until
+const int MIN_ADAPTIVE_RUNS = MIN_ADAPTIVE_CHUNKS * SIMULATION_CHUNK_SIZE;
+
+struct AdaptiveSimulation {
+  ScoreSummary stats; // stats.num_runs is the number of runs used
+  double half_width;  // half width of the 95% confidence interval of the objective
+  bool converged;     // did we reach the target? (otherwise we ran out of budget)
+};
+
+// Simulate until the 95% confidence interval of the objective has a half width of at most target,
+// or until max_runs runs are used (at least MIN_ADAPTIVE_RUNS, rounded up to whole chunks).
+//
+// The runs within a chunk are not independent (the battle rng reduces variance across runs),
+// so the interval is estimated from the variation of the objective between chunks (batch means).
+// Chunks are added in batches whose size depends only on the results so far, so the outcome is deterministic.
+AdaptiveSimulation simulate_until(Board const& player0, Board const& player1, Objective objective, double target, int max_runs, RNG& rng = global_rng) {
+  uint64_t seed = rng.next();
+  int max_chunks = (max(MIN_ADAPTIVE_RUNS, max_runs) + SIMULATION_CHUNK_SIZE - 1) / SIMULATION_CHUNK_SIZE;
+  vector<ScoreSummary> chunk_stats;
+  AdaptiveSimulation result;
+  int batch = MIN_ADAPTIVE_CHUNKS;
+  while (true) {
+    // simulate a batch of chunks
+    int done = (int)chunk_stats.size();
+    chunk_stats.resize(done + batch);
+    global_thread_pool.parallel_for(batch, [&](int c) {
+      chunk_stats[done + c] = simulate_range(player0, player1, seed, (done + c) * SIMULATION_CHUNK_SIZE, SIMULATION_CHUNK_SIZE);
+    });
+    // confidence interval from batch means
+    int k = (int)chunk_stats.size();
+    double sum = 0, sum_sq = 0;
+    for (auto const& s : chunk_stats) {
+      double v = objective_value(objective, s);
+      sum += v;
+      sum_sq += v * v;
+    }
+    double mean = sum / k;
+    if (k > 1) {
+      double var = max(0., (sum_sq - k * mean * mean) / (k - 1));
+      result.half_width = t_quantile_95(k - 1) * std::sqrt(var / k);
+    } else {
+      result.half_width = std::numeric_limits<double>::infinity();
+    }
+    result.converged = result.half_width <= target;
+    if (result.converged || k >= max_chunks) break;
+    // estimate how many chunks are needed in total, but at most double the work
+    double needed = k * (result.half_width / max(target, 1e-12)) * (result.half_width / max(target, 1e-12));
+    batch = (int)std::ceil(needed) - k;
+    batch = max(batch, MIN_ADAPTIVE_CHUNKS / 2);
+    batch = min(batch, k);
+    batch = min(batch, max_chunks - k);
+  }
+  for (auto const& s : chunk_stats) {
+    result.stats += s;
+  }
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+// Paired comparison
+// -----------------------------------------------------------------------------
+
+// Objective values of runs [first_run, first_run+n) of each board against the same enemy, all with the same seed.
+// The values for boards[i] are appended to out[i] in order of the runs.
+void simulate_objective_values(vector<Board> const& boards, Board const& enemy, Objective objective, uint64_t seed, int first_run, int n, vector<vector<double>>& out) {
+  vector<Matchup> matchups;
+  for (auto const& board : boards) {
+    matchups.push_back({board, enemy});
+  }
+  vector<vector<int>> scores;
+  simulate_batch_range(matchups, vector<uint64_t>(boards.size(), seed), first_run, n, &scores);
+  out.resize(max(out.size(), boards.size()));
+  for (size_t i=0; i<boards.size(); ++i) {
+    for (int score : scores[i]) {
+      out[i].push_back(objective_value(objective, score, boards[i], enemy));
+    }
+  }
+}
+
+// Comparison of board b to board a, where run i of both boards uses the same random stream (common random numbers).
+// Differences are taken per run, so the randomness that both boards share cancels out.
+struct PairedComparison {
+  int runs = 0;
+  double mean_a = 0, mean_b = 0;
+  double mean_diff = 0;  // mean of b - a
+  double std_error = 0;  // of mean_diff
+
+  // half width of the 95% confidence interval of mean_diff
+  double half_width() const {
+    return 1.96 * std_error;
+  }
+  // two sided p-value for the hypothesis that there is no difference (normal approximation)
+  double p_value() const {
+    if (std_error <= 0) return mean_diff == 0 ? 1 : 0;
+    return std::erfc(std::abs(mean_diff) / std_error / std::sqrt(2.));
+  }
+};
+
+PairedComparison compare_paired(vector<double> const& a, vector<double> const& b) {
+  PairedComparison result;
+  int n = (int)min(a.size(), b.size());
+  result.runs = n;
+  if (n == 0) return result;
+  double sum_a = 0, sum_b = 0, sum_d = 0, sum_d2 = 0;
+  for (int i=0; i<n; ++i) {
+    double d = b[i] - a[i];
+    sum_a += a[i];
+    sum_b += b[i];
+    sum_d += d;
+    sum_d2 += d * d;
+  }
+  result.mean_a = sum_a / n;
+  result.mean_b = sum_b / n;
+  result.mean_diff = sum_d / n;
+  if (n > 1) {
+    double var = max(0., (sum_d2 - sum_d * result.mean_diff) / (n - 1));
+    result.std_error = std::sqrt(var / n);
+  } else {
+    result.std_error = std::numeric_limits<double>::infinity();
+  }
+  return result;
+}
+
+// number of times that we look at the results when doubling the runs from one chunk to max_runs
+int num_doubling_looks(int max_runs) {
+  int looks = 1;
+  for (int runs = SIMULATION_CHUNK_SIZE; runs < max_runs; runs *= 2) looks++;
+  return looks;
+}
+
+// Compare board b to board a with common random numbers.
+// Runs are added in doubling batches, from one chunk up to max_runs, and we stop as soon as the difference is significant.
+// Looking at the results several times makes false positives more likely, so each look uses level alpha / (number of looks).
+PairedComparison compare_paired(Board const& a, Board const& b, Board const& enemy, Objective objective, uint64_t seed, int max_runs, double alpha = 0.05) {
+  double alpha_per_look = alpha / num_doubling_looks(max_runs);
+  vector<Board> boards = {a, b};
+  vector<vector<double>> values(2);
+  PairedComparison result;
+  int runs = min(max_runs, SIMULATION_CHUNK_SIZE);
+  while (true) {
+    int done = (int)values[0].size();
+    simulate_objective_values(boards, enemy, objective, seed, done, runs - done, values);
+    result = compare_paired(values[0], values[1]);
+    if (runs >= max_runs || result.p_value() < alpha_per_look) break;
+    runs = min(max_runs, 2 * runs);
+  }
+  return result;
+}
+
+void display_p_value(ostream& out, double p) {
+  out.setf(std::ios::fixed, std:: ios::floatfield);
+  out.precision(3);
+  if (p < 0.001) {
+    out << "p < 0.001";
+  } else {
+    out << "p = " << p;
+  }
+}
+
+// show a paired comparison as an improvement with confidence interval and p-value
+void display_improvement(ostream& out, Objective objective, PairedComparison const& cmp) {
+  out << (cmp.mean_diff >= 0 ? "+" : "-");
+  display_objective_difference(out, objective, std::abs(cmp.mean_diff));
+  out << " ± ";
+  display_objective_difference(out, objective, cmp.half_width());
+  out << " (95% confidence, ";
+  display_p_value(out, cmp.p_value());
+  out << ", " << cmp.runs << " paired runs)";
+}
+
 // -----------------------------------------------------------------------------
 // Minion order optimization
 // -----------------------------------------------------------------------------
@@ -225,40 +741,142 @@ inline Board permute_minions(Board const& original, int const perm[], int n) {
   return board;
 }
 
+// Identical minions (for example two plain Alley Cats) are interchangeable,
+// so only the distinct orders of the multiset of minions are considered:
+// Each minion is labeled by the position of the first minion identical to it,
+// and we enumerate the distinct permutations of the labels.
+vector<std::array<int,BOARDSIZE>> distinct_minion_orders(Board const& board) {
+  int n = board.minions.size();
+  std::array<int,BOARDSIZE> labels;
+  labels.fill(BOARDSIZE); // unused labels sort last
+  for (int i=0; i<n; ++i) {
+    labels[i] = i;
+    for (int j=0; j<i; ++j) {
+      if (board.minions[j] == board.minions[i]) {
+        labels[i] = j;
+        break;
+      }
+    }
+  }
+  std::sort(labels.begin(), labels.end());
+  vector<std::array<int,BOARDSIZE>> orders;
+  do {
+    // the k-th occurrence of a label is the k-th minion with that label
+    std::array<int,BOARDSIZE> order;
+    std::array<int,BOARDSIZE> next_of_label;
+    for (int i=0; i<n; ++i) next_of_label[i] = i;
+    for (int i=0; i<n; ++i) {
+      int& pos = next_of_label[labels[i]];
+      while (board.minions[pos] != board.minions[labels[i]]) pos++;
+      order[i] = pos++;
+    }
+    orders.push_back(order);
+  } while (std::next_permutation(labels.begin(), labels.begin() + n));
+  return orders;
+}
+
+// Racing: all orders are evaluated with a few runs, orders that are clearly worse than the leader are dropped,
+// and the runs are doubled for the survivors, until one order remains or the budget is used up.
+// All orders use the same seed and the same ranges of runs (common random numbers),
+// and they are compared to the leader run by run (paired), so differences are not drowned out by the randomness of the battles.
+
+// number of runs per order in the first round of racing
+const int MIN_RACE_RUNS = 4;
+// z-value for dropping orders
+const double RACE_Z = 1.96;
+
 struct OptimizeMinionOrder {
   std::array<int,BOARDSIZE> best_order;
+  // scores of the current and best order, from the final paired comparison.
+  // That comparison stops as soon as the difference is significant, so they can be based on fewer than budget runs.
+  // If the current order is best they are both the score of the current order in a separate simulation of budget runs.
   double current_score;
   double best_score;
+  PairedComparison improvement; // of the best order over the current order (no runs if the current order is best)
   int n;
-  
+  int num_orders;  // number of candidate orders
+  int num_pruned;  // number of orders skipped because they only swap identical minions
+  int total_runs;  // number of battles simulated
+
   OptimizeMinionOrder(Board const& board, Board const& enemy, Objective objective, int budget = DEFAULT_NUM_RUNS, RNG& rng = global_rng) {
     n = board.minions.size();
-    // number of permutations
+    int full_runs = budget;
+    // candidate orders
+    struct Candidate {
+      std::array<int,BOARDSIZE> order;
+      vector<double> values; // objective values of individual runs
+      double mean = 0;
+    };
+    vector<Candidate> alive;
+    for (auto const& order : distinct_minion_orders(board)) {
+      alive.emplace_back();
+      alive.back().order = order;
+    }
+    num_orders = (int)alive.size();
     int nperm = 1;
     for (int i=1; i<=n; ++i) nperm *= i;
-    int runs = max(10, min(budget, budget * 50 / nperm));
-    int full_runs = budget;
-    // current situation
-    std::array<int,BOARDSIZE> order;
-    for (int i=0; i<n; ++i) order[i] = i;
-    current_score = objective_value(objective, simulate_deterministic(board, enemy, rng, full_runs));
-    best_score = current_score;
-    best_order = order;
-    // optimize over all permutations
-    do {
-      Board const& permuted = permute_minions(board, order.data(), n);
-      double score = objective_value(objective, simulate_deterministic(permuted, enemy, rng, runs));
-      if (score > best_score) {
-        best_score = score;
-        best_order = order;
+    num_pruned = nperm - num_orders;
+    // budget, same as simulating all orders budget*50/nperm times
+    int rounds = 1;
+    while ((1 << (rounds-1)) < num_orders) rounds++;
+    int race_budget = budget * 50;
+    int runs = max(MIN_RACE_RUNS, min(full_runs, race_budget / (num_orders * rounds)));
+    total_runs = 0;
+    // race
+    uint64_t seed = rng.next();
+    int next_run = 0; // new runs of each round start at a chunk boundary, so no chunk is replayed
+    while (alive.size() > 1) {
+      int first_run = next_run;
+      int new_runs = runs - (int)alive[0].values.size();
+      vector<Board> boards;
+      vector<vector<double>> values(alive.size());
+      for (size_t i=0; i<alive.size(); ++i) {
+        boards.push_back(permute_minions(board, alive[i].order.data(), n));
+        values[i].swap(alive[i].values);
       }
-    } while (std::next_permutation(order.begin(), order.begin() + n));
-    // re-check with full number of runs, also to avoid multiple-testing bias
-    if (runs < full_runs && best_score > current_score) {
-      Board const& permuted = permute_minions(board, best_order.data(), n);
-      best_score = objective_value(objective, simulate_deterministic(permuted, enemy, rng, full_runs));
+      simulate_objective_values(boards, enemy, objective, seed, first_run, new_runs, values);
+      for (size_t i=0; i<alive.size(); ++i) {
+        alive[i].values.swap(values[i]);
+        alive[i].mean = mean(alive[i].values);
+      }
+      next_run += (new_runs + SIMULATION_CHUNK_SIZE - 1) / SIMULATION_CHUNK_SIZE * SIMULATION_CHUNK_SIZE;
+      total_runs += new_runs * (int)alive.size();
+      // drop orders that are significantly worse than the leader, and keep at most half
+      std::stable_sort(alive.begin(), alive.end(), [](Candidate const& a, Candidate const& b) {
+        return a.mean > b.mean;
+      });
+      auto worse = std::stable_partition(alive.begin() + 1, alive.end(), [&](Candidate const& c) {
+        PairedComparison cmp = compare_paired(alive[0].values, c.values);
+        return cmp.mean_diff + RACE_Z * cmp.std_error >= 0;
+      });
+      size_t keep = worse - alive.begin();
+      keep = min(keep, (alive.size() + 1) / 2);
+      // only keep as many orders as the remaining budget allows
+      int remaining = race_budget - total_runs;
+      keep = min(keep, (size_t)max(0, remaining / runs));
+      if (keep <= 1) break;
+      alive.resize(keep);
+      runs *= 2;
+    }
+    best_order = alive[0].order;
+    bool identity = true;
+    for (int i=0; i<n; ++i) {
+      if (best_order[i] != i) identity = false;
     }
-    rng.jump();
+    if (identity) {
+      // the race mean of the winner is biased upwards, so simulate it again with new random numbers
+      // (this is also the only simulation if there is just one distinct order)
+      ScoreSummary stats = simulate(board, enemy, full_runs, rng);
+      current_score = best_score = objective_value(objective, stats);
+      total_runs += stats.num_runs;
+      return;
+    }
+    // compare to the current order with new random numbers, to avoid multiple-testing bias
+    Board const& permuted = permute_minions(board, best_order.data(), n);
+    improvement = compare_paired(board, permuted, enemy, objective, rng.next(), full_runs);
+    current_score = improvement.mean_a;
+    best_score = improvement.mean_b;
+    total_runs += 2 * improvement.runs;
   }
 };
 
@@ -266,27 +884,49 @@ struct OptimizeMinionOrder {
 // Minion buff optimization
 // -----------------------------------------------------------------------------
 
+// All placements are simulated on the same runs (common random numbers), in doubling batches.
+// We stop early once the best placement is significantly better than all others.
+
 struct OptimizeMinionBuffPlacement {
   double scores[BOARDSIZE];
   double current_score;
   double best_score;
-  
-  OptimizeMinionBuffPlacement(Board const& board, Board const& enemy, Minion const& buff, Objective objective, int budget = DEFAULT_NUM_RUNS, RNG& rng = global_rng) {
+  PairedComparison best_vs_next; // best placement compared to the placement it is least clearly better than
+  int total_runs;
+
+  OptimizeMinionBuffPlacement(Board const& board, Board const& enemy, Minion const& buff, Objective objective, int budget = DEFAULT_NUM_RUNS, RNG& rng = global_rng, double alpha = 0.05) {
     int full_runs = budget;
-    // current situation
-    current_score = objective_value(objective, simulate_deterministic(board, enemy, rng, full_runs));
-    best_score = current_score;
-    // optimize over all placements
-    board.minions.for_each_with_pos([&](int i, Minion const&) {
-      Board new_board = board;
-      new_board.minions[i].buff(buff);
-      double score = objective_value(objective, simulate_deterministic(new_board, enemy, rng, full_runs));
-      scores[i] = score;
-      if (i == 0 || score > best_score) {
-        best_score = score;
+    int n = board.minions.size();
+    // boards to evaluate: the current board followed by all placements
+    vector<Board> boards(n+1, board);
+    for (int i=0; i<n; ++i) {
+      boards[i+1].minions[i].buff(buff);
+    }
+    vector<vector<double>> values(n+1);
+    uint64_t seed = rng.next();
+    double alpha_per_look = alpha / num_doubling_looks(full_runs);
+    int runs = min(full_runs, SIMULATION_CHUNK_SIZE);
+    int best = 0;
+    while (true) {
+      int done = (int)values[0].size();
+      simulate_objective_values(boards, enemy, objective, seed, done, runs - done, values);
+      // best placement, and is it significantly better than all others?
+      for (int i=0; i<n; ++i) {
+        scores[i] = mean(values[i+1]);
+        if (i == 0 || scores[i] > scores[best]) best = i;
       }
-    });
-    rng.jump();
+      best_vs_next = PairedComparison();
+      for (int i=0; i<n; ++i) {
+        if (i == best) continue;
+        PairedComparison cmp = compare_paired(values[i+1], values[best+1]);
+        if (best_vs_next.runs == 0 || cmp.p_value() > best_vs_next.p_value()) best_vs_next = cmp;
+      }
+      if (runs >= full_runs || (best_vs_next.runs > 0 && best_vs_next.p_value() < alpha_per_look)) break;
+      runs = min(full_runs, 2 * runs);
+    }
+    current_score = mean(values[0]);
+    best_score = n > 0 ? scores[best] : current_score;
+    total_runs = runs * (n+1);
   }
 };
 
@@ -0,0 +1,151 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+// Thread pool
+// -----------------------------------------------------------------------------
+
+// the queue owned by the current thread, if it is a worker
+static thread_local ThreadPool const* current_pool = nullptr;
+static thread_local int current_queue = -1;
+
+ThreadPool::ThreadPool(int num_threads)
+  : num_queued(0)
+{
+  start(num_threads - 1);
+}
+
+ThreadPool::~ThreadPool() {
+  stop();
+}
+
+void ThreadPool::resize(int num_threads) {
+  if (num_threads == this->num_threads()) return;
+  stop();
+  start(num_threads - 1);
+}
+
+void ThreadPool::start(int num_workers) {
+  #if __EMSCRIPTEN__
+    num_workers = 0; // constructing a std::thread would throw
+  #else
+    num_workers = std::max(0, num_workers);
+  #endif
+  stopping = false;
+  queues.clear();
+  for (int i=0; i<=num_workers; ++i) {
+    queues.emplace_back(new Queue);
+  }
+  for (int i=0; i<num_workers; ++i) {
+    workers.emplace_back([this,i]() { worker_loop(i); });
+  }
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake_up.notify_all();
+  for (auto& w : workers) w.join();
+  workers.clear();
+}
+
+// -----------------------------------------------------------------------------
+// Queues
+// -----------------------------------------------------------------------------
+
+void ThreadPool::submit(Task&& task) {
+  int q = current_pool == this ? current_queue : (int)workers.size();
+  {
+    std::lock_guard<std::mutex> lock(queues[q]->mutex);
+    queues[q]->tasks.push_back(std::move(task));
+  }
+  num_queued++;
+  {
+    // lock to make sure that a worker that is about to sleep sees the new task
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+  }
+  wake_up.notify_one();
+}
+
+// take the most recently submitted task from a queue
+bool ThreadPool::pop(int q, Task& out) {
+  std::lock_guard<std::mutex> lock(queues[q]->mutex);
+  if (queues[q]->tasks.empty()) return false;
+  out = std::move(queues[q]->tasks.back());
+  queues[q]->tasks.pop_back();
+  num_queued--;
+  return true;
+}
+
+// take the oldest task from a queue
+bool ThreadPool::steal(int q, Task& out) {
+  std::lock_guard<std::mutex> lock(queues[q]->mutex);
+  if (queues[q]->tasks.empty()) return false;
+  out = std::move(queues[q]->tasks.front());
+  queues[q]->tasks.pop_front();
+  num_queued--;
+  return true;
+}
+
+// run a single task if there is one, own queue first
+bool ThreadPool::run_one() {
+  int n = (int)queues.size();
+  int self = current_pool == this ? current_queue : n - 1;
+  Task task;
+  bool found = pop(self, task);
+  for (int i=1; i<n && !found; ++i) {
+    found = steal((self + i) % n, task);
+  }
+  if (!found) return false;
+  try {
+    task.fun();
+  } catch (...) {
+    // keep the worker alive and the group counting down, wait() rethrows
+    std::lock_guard<std::mutex> lock(task.group->mutex);
+    if (!task.group->error) task.group->error = std::current_exception();
+  }
+  task.group->pending--;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Running tasks
+// -----------------------------------------------------------------------------
+
+void ThreadPool::wait(Group& group) {
+  // help out until all tasks of the group are done
+  while (group.pending > 0) {
+    if (!run_one()) {
+      // the remaining tasks are running on other threads
+      std::this_thread::yield();
+    }
+  }
+  if (group.error) std::rethrow_exception(group.error);
+}
+
+void ThreadPool::worker_loop(int index) {
+  current_pool = this;
+  current_queue = index;
+  while (true) {
+    if (run_one()) continue;
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    wake_up.wait(lock, [this]() { return stopping || num_queued > 0; });
+    if (stopping) return;
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Global thread pool
+// -----------------------------------------------------------------------------
+
+int default_num_threads() {
+  #if __EMSCRIPTEN__
+    return 1;
+  #else
+    return std::max(1, (int)std::thread::hardware_concurrency());
+  #endif
+}
+
+ThreadPool global_thread_pool(default_num_threads());
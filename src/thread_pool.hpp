@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Work stealing thread pool
+// -----------------------------------------------------------------------------
+
+// A fixed set of worker threads that run tasks.
+//
+// Each worker has its own task queue, it takes tasks from the back of its own queue,
+// and when that is empty it steals from the front of the other queues.
+// Threads that are waiting for their tasks to finish run queued tasks in the meantime,
+// so tasks can submit more tasks and wait for them (nested parallelism) without deadlocks.
+class ThreadPool {
+public:
+  // num_threads is the total number of threads that do work, including the calling thread
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  int num_threads() const {
+    return (int)workers.size() + 1;
+  }
+  // change the number of threads, should only be called when the pool is idle
+  // (the web build has no threads, so there it always uses just the calling thread)
+  void resize(int num_threads);
+
+  // Call fun(i) for all 0 <= i < n, possibly in parallel.
+  // Returns when all calls are done, if any of them threw an exception, the first one is rethrown.
+  template <typename F>
+  void parallel_for(int n, F const& fun) {
+    if (n <= 1 || workers.empty()) {
+      for (int i=0; i<n; ++i) fun(i);
+      return;
+    }
+    Group group(n);
+    for (int i=0; i<n; ++i) {
+      submit({[&fun,i]() { fun(i); }, &group});
+    }
+    wait(group);
+  }
+
+private:
+  // tasks submitted together, that we wait for together
+  struct Group {
+    std::atomic<int> pending; // number of unfinished tasks
+    std::mutex mutex;
+    std::exception_ptr error; // first exception thrown by a task
+    explicit Group(int n) : pending(n) {}
+  };
+  struct Task {
+    std::function<void()> fun;
+    Group* group;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+  // queues[i] belongs to worker i, the last queue is for tasks submitted from other threads
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<int> num_queued;
+  std::mutex sleep_mutex;
+  std::condition_variable wake_up;
+  bool stopping = false;
+
+  void start(int num_workers);
+  void stop();
+  void submit(Task&& task);
+  bool pop(int queue, Task& out);
+  bool steal(int queue, Task& out);
+  bool run_one();
+  void wait(Group& group);
+  void worker_loop(int index);
+};
+
+// -----------------------------------------------------------------------------
+// Global thread pool
+// -----------------------------------------------------------------------------
+
+int default_num_threads();
+
+// The thread pool used for simulations
+extern ThreadPool global_thread_pool;
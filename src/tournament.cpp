@@ -16,19 +16,28 @@ void tournament(Boards const& boards) {
   auto stats = [&](int i, int j) -> ScoreSummary& {
     return the_stats[i*n+j];
   };
+  // simulate all matchups i<=j in one batch
+  vector<std::pair<int,int>> pairs;
+  vector<Matchup> matchups;
+  for (int i=0; i<n; ++i) {
+    for (int j=i; j<n; ++j) {
+      pairs.push_back({i,j});
+      matchups.push_back({boards[i].board, boards[j].board});
+    }
+  }
+  vector<ScoreSummary> results = simulate_batch(matchups, DEFAULT_NUM_RUNS);
+  for (size_t k=0; k<pairs.size(); ++k) {
+    int i = pairs[k].first, j = pairs[k].second;
+    stats(i,j) = results[k];
+    stats(j,i) = results[k].flipped();
+  }
   for (int i=0; i<n; ++i) {
     cout << "turn " << boards[i].turn;
     cout << "\t" << boards[i].turn;
     cout << "\t" << boards[i].board.total_stats();
-    for (int j=0; j<i; ++j) {
+    for (int j=0; j<n; ++j) {
       cout << "\t" << setprecision(3) << stats(i,j).damage_score();
     }
-    for (int j=i; j<n; ++j) {
-      ScoreSummary result = simulate(boards[i].board, boards[j].board);
-      cout << "\t" << setprecision(3) << result.damage_score();
-      stats(i,j) = result;
-      stats(j,i) = result.flipped();
-    }
     cout << endl;
   }
   // damage taken
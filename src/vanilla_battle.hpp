@@ -0,0 +1,139 @@
+#pragma once
+#include "battle.hpp"
+
+// -----------------------------------------------------------------------------
+// Vanilla battles
+// -----------------------------------------------------------------------------
+
+// A minion is vanilla if it can only attack and take damage during battle.
+// Keywords (taunt, divine shield, poison, windfury, cleave) are fine, but no auras, deathrattles, reborn or triggers.
+inline bool is_vanilla(Minion const& m) {
+  return !event_hooks(m.type) && !Board::is_multiplier_minion(m.type)
+      && !m.reborn && !m.deathrattle_murlocs && !m.deathrattle_microbots
+      && !m.deathrattle_golden_microbots && !m.deathrattle_plants;
+}
+
+inline bool is_vanilla(Board const& board) {
+  if (board.use_hero_power && board.hero != HeroType::None) return false;
+  for (int i=0; board.minions.contains(i); ++i) {
+    if (!is_vanilla(board.minions[i])) return false;
+  }
+  return true;
+}
+
+// A battle between two vanilla boards.
+// No effects can fire, so this skips auras, triggers, death bookkeeping and summoning.
+// It makes the same random choices in the same order as BasicBattle, so the results are identical.
+// Build with CHECK_VANILLA=1 to compare every simulation against BasicBattle.
+template <typename R>
+struct VanillaBattle {
+  int turn = -1; // player to attack next
+  Board board[2];
+  R& rng;
+
+  // start from a prepared battle (see Battle(Battle const&,R&))
+  VanillaBattle(Battle const& prepared, R& rng)
+    : turn(prepared.turn)
+    , board{prepared.board[0],prepared.board[1]}
+    , rng(rng)
+  {}
+
+  bool done() const {
+    return board[0].minions.empty() || board[1].minions.empty() || turn >= 2;
+  }
+
+  int score() const {
+    int stars0 = board[0].total_stars();
+    int stars1 = board[1].total_stars();
+    if (stars0 > 0 && stars1 > 0) return 0;
+    return stars0 - stars1;
+  }
+
+  void run() {
+    start();
+    bool missed_prev = false;
+    while (!done()) {
+      bool ok = attack_round();
+      if (missed_prev && !ok) {
+        turn = 2; // indicate battle is done
+        return;
+      }
+      missed_prev = !ok;
+    }
+  }
+
+  // see BasicBattle::start
+  void start(int first_player = -1) {
+    if (turn >= 0) return;
+    int n0 = board[0].minions.size(), n1 = board[1].minions.size();
+    if (n0 > n1) {
+      turn = 0;
+    } else if (n0 < n1) {
+      turn = 1;
+    } else if (first_player >= 0) {
+      turn = first_player;
+    } else {
+      turn = rng.random(2, rng_key(RNGType::FirstPlayer));
+    }
+    board[0].next_attacker = 0;
+    board[1].next_attacker = 0;
+  }
+
+private:
+
+  bool attack_round() {
+    int from = find_attacker(board[turn]);
+    if (from == -1) {
+      turn = 1 - turn;
+      return false;
+    }
+    // minions only die in their own attack, and then nobody moves to their position
+    int num_attacks = board[turn].minions[from].num_attacks();
+    for (int i=0; i < num_attacks; ++i) {
+      if (!single_attack_by(turn, from)) break; // attacker died
+    }
+    turn = 1 - turn;
+    return true;
+  }
+
+  // returns true if the attacker survived
+  bool single_attack_by(int player, int from) {
+    Minion& attacker = board[player].minions[from];
+    MinionArray<BOARDSIZE>& enemy = board[1-player].minions;
+    if (enemy.empty()) return true;
+    int target = attacker.type == MinionType::ZappSlywick
+                   ? board[1-player].lowest_attack_target(rng, rng_key(RNGType::Attack,player,attacker))
+                   : board[1-player].random_attack_target(rng, rng_key(RNGType::Attack,player,attacker));
+    Minion defender_snapshot = enemy[target];
+    damage(enemy[target], attacker);
+    if (attacker.cleave()) {
+      if (enemy.contains(target-1)) damage(enemy[target-1], attacker);
+      if (enemy.contains(target+1)) damage(enemy[target+1], attacker);
+    }
+    damage(attacker, defender_snapshot);
+    remove_dead(enemy);
+    if (attacker.dead()) {
+      board[player].minions.remove(from);
+      return false;
+    }
+    return true;
+  }
+
+  static void damage(Minion& m, Minion const& attacker) {
+    if (attacker.attack <= 0) return;
+    if (m.divine_shield) {
+      m.divine_shield = false;
+    } else {
+      m.health = clamp_stat(m.health - attacker.attack);
+      if (m.health > 0 && attacker.poison) {
+        m.health = 0;
+      }
+    }
+  }
+
+  static void remove_dead(MinionArray<BOARDSIZE>& minions) {
+    for (int i=minions.size()-1; i>=0; --i) {
+      if (minions[i].dead()) minions.remove(i);
+    }
+  }
+};
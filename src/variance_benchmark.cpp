@@ -3,45 +3,184 @@
 #include <iomanip>
 #include <chrono>
 #include <cmath>
+#include <ctime>
+#include <cstring>
 using namespace std;
 
+// -----------------------------------------------------------------------------
+// Variance and cost of each rng policy
+// -----------------------------------------------------------------------------
+
+// Measurements for one rng policy on one matchup
+struct VarianceResult {
+  RNGPolicy policy;
+  int i, j; // boards
+  int runs, reps;
+  double mean;              // mean win rate over all repetitions
+  double variance;          // variance of the win rate estimate of a single simulation
+  double expected_variance; // variance for independent runs: mean*(1-mean)/runs
+  double cpu_seconds, wall_seconds; // for all repetitions
+
+  double variance_ratio() const {
+    return variance / expected_variance;
+  }
+  // number of independent runs that would give the same variance as one simulation
+  double effective_runs() const {
+    return mean * (1 - mean) / variance;
+  }
+  double effective_runs_per_cpu_second() const {
+    return effective_runs() * reps / cpu_seconds;
+  }
+  // without a measured variance the effective number of runs is unknown
+  bool has_effective_runs() const {
+    return variance > 0 && expected_variance > 0;
+  }
+  // very fast simulations can take less than the resolution of the clock
+  bool has_effective_runs_per_cpu_second() const {
+    return has_effective_runs() && cpu_seconds > 0;
+  }
+};
+
+VarianceResult measure_variance(Boards const& boards, int i, int j, RNGPolicy policy, int runs, int reps) {
+  using namespace std::chrono;
+  VarianceResult r;
+  r.policy = policy;
+  r.i = i; r.j = j;
+  r.runs = runs; r.reps = reps;
+  // independent repetitions of the same matchup
+  vector<Matchup> matchups(reps, {boards[i].board, boards[j].board});
+  RNGPolicy old_policy = battle_rng_policy;
+  battle_rng_policy = policy;
+  RNG rng = RNG::stream(i * boards.size() + j, 0); // same seeds for each policy
+  // only the cpu time of the simulations with a single thread (see main),
+  // otherwise it includes the calling thread waiting for the pool, and on Windows clock() is wall time
+  clock_t cpu_start = clock();
+  auto wall_start = high_resolution_clock::now();
+  vector<ScoreSummary> stats = simulate_batch(matchups, runs, rng);
+  duration<double> wall = high_resolution_clock::now() - wall_start;
+  r.cpu_seconds = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+  r.wall_seconds = wall.count();
+  battle_rng_policy = old_policy;
+  vector<double> winrates;
+  for (auto const& s : stats) {
+    winrates.push_back(s.win_rate(0));
+  }
+  r.mean = mean(winrates);
+  r.variance = variance(winrates);
+  r.expected_variance = r.mean * (1 - r.mean) / runs;
+  return r;
+}
+
+// -----------------------------------------------------------------------------
+// Output
+// -----------------------------------------------------------------------------
+
+enum class OutputFormat { Text, CSV, JSON };
+
+void write_header(ostream& out, OutputFormat format) {
+  if (format == OutputFormat::CSV) {
+    out << "rng,board0,board1,runs,reps,mean,variance,expected_variance,variance_ratio,cpu_seconds,wall_seconds,effective_runs_per_cpu_second" << endl;
+  } else if (format == OutputFormat::JSON) {
+    out << "[";
+  }
+}
+
+void write_footer(ostream& out, OutputFormat format) {
+  if (format == OutputFormat::JSON) {
+    out << endl << "]" << endl;
+  }
+}
+
+void write_result(ostream& out, OutputFormat format, VarianceResult const& r, bool first) {
+  out << setprecision(6);
+  if (format == OutputFormat::CSV) {
+    out << name(r.policy) << "," << r.i << "," << r.j << "," << r.runs << "," << r.reps;
+    out << "," << r.mean << "," << r.variance << "," << r.expected_variance;
+    out << ",";
+    if (r.has_effective_runs()) out << r.variance_ratio();
+    out << "," << r.cpu_seconds << "," << r.wall_seconds;
+    out << ",";
+    if (r.has_effective_runs_per_cpu_second()) out << r.effective_runs_per_cpu_second();
+    out << endl;
+  } else if (format == OutputFormat::JSON) {
+    out << (first ? "" : ",") << endl;
+    out << "  {\"rng\": \"" << name(r.policy) << "\", \"board0\": " << r.i << ", \"board1\": " << r.j;
+    out << ", \"runs\": " << r.runs << ", \"reps\": " << r.reps;
+    out << ", \"mean\": " << r.mean << ", \"variance\": " << r.variance << ", \"expected_variance\": " << r.expected_variance;
+    out << ", \"variance_ratio\": ";
+    if (r.has_effective_runs()) out << r.variance_ratio(); else out << "null";
+    out << ", \"cpu_seconds\": " << r.cpu_seconds << ", \"wall_seconds\": " << r.wall_seconds;
+    out << ", \"effective_runs_per_cpu_second\": ";
+    if (r.has_effective_runs_per_cpu_second()) out << r.effective_runs_per_cpu_second(); else out << "null";
+    out << "}";
+  } else {
+    out << setw(16) << left << name(r.policy) << right << " " << r.i << " vs " << r.j;
+    out << "  m:" << setprecision(5) << r.mean << " s:" << sqrt(r.variance) << "     Es:" << sqrt(r.expected_variance);
+    if (r.has_effective_runs()) {
+      out << " actual is " << r.variance_ratio();
+    }
+    out << "    cpu: " << setprecision(3) << r.cpu_seconds << "s";
+    if (r.has_effective_runs_per_cpu_second()) {
+      out << "    effective runs/cpu-sec: " << setprecision(4) << r.effective_runs_per_cpu_second();
+    }
+    out << endl;
+  }
+}
+
 // -----------------------------------------------------------------------------
 // Pair off a bunch of boards
 // -----------------------------------------------------------------------------
 
-void rng_variance_test(Boards const& boards) {
+void rng_variance_test(Boards const& boards, OutputFormat format) {
   using namespace std::chrono;
   int runs = 1000;
   int reps = 100;
   int n = (int)boards.size();
   auto start = high_resolution_clock::now();
+  bool first = true;
+  write_header(cout, format);
   for (int i=0; i<n; ++i) {
     for (int j=0; j<n; ++j) {
       if (abs(boards[i].board.total_stats() - boards[j].board.total_stats()) > 11) continue;
-      vector<double> winrates;
-      cout << i << " vs " << j << " ";
-      cout << "(" << boards[i].board.total_stats() << " vs " << boards[j].board.total_stats() << ") ";
-      for (int rep=0; rep<reps; ++rep) {
-        auto stats = simulate(boards[i].board, boards[j].board, runs);
-        winrates.push_back(stats.win_rate(0));
+      if (format == OutputFormat::Text) {
+        cout << i << " vs " << j << " ";
+        cout << "(" << boards[i].board.total_stats() << " vs " << boards[j].board.total_stats() << ")" << endl;
+      }
+      for (int p=0; p<NUM_RNG_POLICIES; ++p) {
+        VarianceResult r = measure_variance(boards, i, j, static_cast<RNGPolicy>(p), runs, reps);
+        write_result(cout, format, r, first);
+        first = false;
       }
-      double m = mean(winrates);
-      double v = variance(winrates);
-      double ev = m * (1-m) / runs;
-      cout << " m:" << setprecision(5) << m << " s:" << sqrt(v) << "     Es:" << sqrt(ev) << " actual is " << (v/ev) << endl;
     }
   }
+  write_footer(cout, format);
   auto end = high_resolution_clock::now();
   duration<double> t = end-start;
-  cout << "Time: " << setprecision(5) << t.count() << endl;
+  if (format == OutputFormat::Text) {
+    cout << "Time: " << setprecision(5) << t.count() << endl;
+  }
 }
 
 // -----------------------------------------------------------------------------
 // Main function
 // -----------------------------------------------------------------------------
 
+// Usage: variance-benchmark [--csv|--json] [boards file]
 int main(int argc, char const** argv) {
+  // simulate on a single thread, so that we measure the cpu time of the simulations
+  global_thread_pool.resize(1);
+  OutputFormat format = OutputFormat::Text;
+  const char* filename = "examples/variance-benchmark-boards.txt";
+  for (int i=1; i<argc; ++i) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      format = OutputFormat::CSV;
+    } else if (strcmp(argv[i], "--json") == 0) {
+      format = OutputFormat::JSON;
+    } else {
+      filename = argv[i];
+    }
+  }
   Boards boards;
-  if (!load_boards("examples/variance-benchmark-boards.txt", boards)) return 1;
-  rng_variance_test(boards);
+  if (!load_boards(filename, boards)) return 1;
+  rng_variance_test(boards, format);
 }